@@ -78,21 +78,28 @@ class PropertyAction : public ActionObject
 public:
 
     PropertyAction(const QString &endpoint, const QString &property, Statement statement, const QVariant &value) :
-        ActionObject(Type::property), m_endpoint(endpoint), m_property(property), m_statement(statement), m_value(value) {}
+        ActionObject(Type::property), m_endpoint(endpoint), m_property(property), m_propertyId(property != "triggerProperty" ? Symbols::id(property) : 0), m_statement(statement), m_value(value) {}
 
     inline QString endpoint(void) { return m_endpoint; }
     inline QString property(void) { return m_property; }
+    inline quint32 propertyId(void) { return m_propertyId; }
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
 
+    inline std::shared_ptr <const DeviceBinding> binding(void) { return m_binding.load(); }
+    inline void bind(const Device &device, quint8 endpointId) { m_binding.store(DeviceBinding(device, endpointId)); }
+
     QVariant value(const QVariant &oldValue);
 
 private:
 
     QString m_endpoint, m_property;
+    quint32 m_propertyId;
     Statement m_statement;
     QVariant m_value;
 
+    Snapshot <DeviceBinding> m_binding;
+
 };
 
 class MqttAction : public ActionObject
@@ -188,7 +195,7 @@ public:
     inline ConditionObject::Type conditionType(void) { return m_conditionType; }
     inline bool hideElse(void) { return m_hideElse; }
 
-    inline QList <Condition> &conditions(void) { return m_conditions; }
+    inline ConditionList &conditions(void) { return m_conditions; }
     inline ActionList &actions(bool match) { return match ? m_then : m_else; }
 
 private:
@@ -196,7 +203,7 @@ private:
     ConditionObject::Type m_conditionType;
     bool m_hideElse;
 
-    QList <Condition> m_conditions;
+    ConditionList m_conditions;
     ActionList m_then, m_else;
 
 };
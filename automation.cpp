@@ -2,9 +2,10 @@
 #include "controller.h"
 #include "logger.h"
 
-AutomationList::AutomationList(QSettings *config, QObject *parent) : QObject(parent), m_timer(new QTimer(this)), m_sync(false)
+AutomationList::AutomationList(QSettings *config, QObject *parent) : QObject(parent), m_timer(new QTimer(this)), m_files(new FileCache(this)), m_sync(false)
 {
     m_automationModes = QMetaEnum::fromType <AutomationObject::Mode> ();
+    m_overflowPolicies = QMetaEnum::fromType <AutomationObject::Overflow> ();
 
     m_triggerTypes = QMetaEnum::fromType <TriggerObject::Type> ();
     m_conditionTypes = QMetaEnum::fromType <ConditionObject::Type> ();
@@ -14,6 +15,8 @@ AutomationList::AutomationList(QSettings *config, QObject *parent) : QObject(par
     m_conditionStatements = QMetaEnum::fromType <ConditionObject::Statement> ();
     m_actionStatements = QMetaEnum::fromType <ActionObject::Statement> ();
 
+    m_triggerUnits = QMetaEnum::fromType <TriggerObject::Unit> ();
+
     m_file.setFileName(config->value("automation/database", "/opt/homed-automation/database.json").toString());
     m_telegramChat = config->value("telegram/chat").toLongLong();
 
@@ -30,6 +33,7 @@ AutomationList::~AutomationList(void)
 void AutomationList::init(void)
 {
     QJsonObject json, messages;
+    QMap <QString, QVariant> states;
 
     if (!m_file.open(QFile::ReadOnly))
         return;
@@ -38,7 +42,10 @@ void AutomationList::init(void)
     messages = json.value("messages").toObject();
 
     unserialize(json.value("automations").toArray());
-    m_states = json.value("states").toObject().toVariantMap();
+    states = json.value("states").toObject().toVariantMap();
+
+    for (auto it = states.begin(); it != states.end(); it++)
+        m_states.insert(it.key(), it.value());
 
     for (auto it = messages.begin(); it != messages.end(); it++)
     {
@@ -69,6 +76,23 @@ AutomationObject::Mode AutomationList::getMode(const QJsonObject &json)
     return value < 0 ? AutomationObject::Mode::single : static_cast <AutomationObject::Mode> (value);
 }
 
+AutomationObject::Overflow AutomationList::getOverflow(const QJsonObject &json)
+{
+    int value = m_overflowPolicies.keyToValue(json.value("overflow").toString().toUtf8().constData());
+    return value < 0 ? AutomationObject::Overflow::dropNewest : static_cast <AutomationObject::Overflow> (value);
+}
+
+Pattern AutomationList::pattern(const QString &string)
+{
+    Pattern pattern;
+
+    m_lock.lockForRead();
+    pattern = m_patterns.value(string);
+    m_lock.unlock();
+
+    return pattern.isNull() ? PatternObject::compile(string) : pattern;
+}
+
 Automation AutomationList::byUuid(const QString &uuid, int *index)
 {
     for (int i = 0; i < count(); i++)
@@ -100,6 +124,9 @@ Automation AutomationList::parse(const QJsonObject &json, bool add)
     Automation automation(new AutomationObject(getMode(json), add || uuid.isEmpty() ? randomData(16).toHex() : uuid, json.value("name").toString().trimmed(), json.value("note").toString(), json.value("active").toBool(), json.value("log").toBool(), json.value("debounce").toInt(), json.value("lastTriggered").toVariant().toLongLong()));
     QJsonArray triggers = json.value("triggers").toArray();
 
+    m_parsed.clear();
+    automation->setLimits(qMax(json.value("maxQueued").toInt(), 0), qMax(json.value("maxParallel").toInt(), 0), getOverflow(json));
+
     for (auto it = triggers.begin(); it != triggers.end(); it++)
     {
         QJsonObject item = it->toObject();
@@ -175,7 +202,12 @@ Automation AutomationList::parse(const QJsonObject &json, bool add)
 
             case TriggerObject::Type::interval:
             {
-                trigger = Trigger(new IntervalTrigger(item.value("interval").toInt(), item.value("offset").toInt()));
+                int unit = m_triggerUnits.keyToValue(item.value("unit").toString().toUtf8().constData()), interval = item.value("interval").toInt();
+
+                if (unit == static_cast <int> (TriggerObject::Unit::milliseconds) && interval && qAbs(interval) < INTERVAL_TRIGGER_LIMIT)
+                    interval = INTERVAL_TRIGGER_LIMIT;
+
+                trigger = Trigger(new IntervalTrigger(interval, item.value("offset").toInt(), unit < 0 ? TriggerObject::Unit::minutes : static_cast <TriggerObject::Unit> (unit)));
                 break;
             }
 
@@ -196,6 +228,7 @@ Automation AutomationList::parse(const QJsonObject &json, bool add)
 
     unserializeConditions(automation->conditions(), json.value("conditions").toArray());
     unserializeActions(automation->actions(), json.value("actions").toArray(), add);
+    automation->patterns() = m_parsed;
 
     if (automation->name().isEmpty() || automation->triggers().isEmpty() || automation->actions().isEmpty())
         return Automation();
@@ -203,6 +236,24 @@ Automation AutomationList::parse(const QJsonObject &json, bool add)
     return automation;
 }
 
+void AutomationList::append(const Automation &automation)
+{
+    QList <Automation>::append(automation);
+    updateIndex();
+}
+
+void AutomationList::replace(int index, const Automation &automation)
+{
+    QList <Automation>::replace(index, automation);
+    updateIndex();
+}
+
+void AutomationList::removeAt(int index)
+{
+    QList <Automation>::removeAt(index);
+    updateIndex();
+}
+
 QByteArray AutomationList::randomData(int length)
 {
     QByteArray data;
@@ -213,24 +264,225 @@ QByteArray AutomationList::randomData(int length)
     return data;
 }
 
-void AutomationList::parsePattern(const QString &string)
+void AutomationList::invalidateProperties(void)
+{
+    for (auto it = m_propertyConditions.begin(); it != m_propertyConditions.end(); it++)
+        invalidate(it.value());
+}
+
+bool AutomationList::updateState(const QString &name, const QVariant &value)
 {
-    QRegExp pattern("\\{\\{[^\\{\\}]*\\}\\}");
-    int position = 0;
+    if (m_states.value(name) == value)
+        return false;
+
+    m_states.insert(name, value);
+    invalidateState(name);
+    return true;
+}
+
+void AutomationList::invalidate(const QList <Condition> &list)
+{
+    for (int i = 0; i < list.count(); i++)
+        list.at(i)->invalidate();
+}
 
-    while ((position = pattern.indexIn(string, position)) != -1)
+void AutomationList::updateIndex(void)
+{
+    QSet <QString> patterns, paths;
+
+    m_propertyTriggers.clear();
+    m_mqttTriggers.clear();
+
+    m_propertyConditions.clear();
+    m_stateConditions.clear();
+    m_mqttConditions.clear();
+
+    m_endpointConditions.clear();
+    m_endpointActions.clear();
+
+    for (int i = 0; i < count(); i++)
     {
-        QString item = pattern.cap();
-        QList <QString> list = item.mid(2, item.length() - 4).split('|');
+        const Automation &automation = at(i);
+
+        for (int j = 0; j < automation->triggers().count(); j++)
+        {
+            const Trigger &trigger = automation->triggers().at(j);
 
-        if (list.value(0).trimmed() == "mqtt")
-            emit addSubscription(list.value(1).trimmed());
+            switch (trigger->type())
+            {
+                case TriggerObject::Type::property:
+                {
+                    PropertyTrigger *item = reinterpret_cast <PropertyTrigger*> (trigger.data());
+                    m_propertyTriggers[item->endpoint()][item->property()].append(TriggerReference(automation, j));
+                    break;
+                }
+
+                case TriggerObject::Type::mqtt:
+                {
+                    MqttTrigger *item = reinterpret_cast <MqttTrigger*> (trigger.data());
+                    m_mqttTriggers.insert(item->topic(), TriggerReference(automation, j));
+                    break;
+                }
+
+                default: break;
+            }
+        }
+
+        updateIndex(automation->conditions());
+        updateIndex(automation->actions());
+        patterns.unite(automation->patterns());
+    }
+
+    m_lock.lockForWrite();
+
+    for (auto it = m_patterns.begin(); it != m_patterns.end();)
+    {
+        if (!patterns.contains(it.key()))
+        {
+            it = m_patterns.erase(it);
+            continue;
+        }
 
-        position += item.length();
+        filePaths(it.value(), paths);
+        it++;
     }
+
+    m_lock.unlock();
+    m_files->retain(paths);
 }
 
-void AutomationList::unserializeConditions(QList <Condition> &list, const QJsonArray &conditions)
+void AutomationList::updateIndex(const ConditionList &list)
+{
+    for (int i = 0; i < list.count(); i++)
+    {
+        const Condition &condition = list.at(i);
+
+        switch (condition->type())
+        {
+            case ConditionObject::Type::property:
+            {
+                PropertyCondition *item = reinterpret_cast <PropertyCondition*> (condition.data());
+
+                if (item->cacheable())
+                    m_propertyConditions[item->property()].append(condition);
+
+                if (item->endpoint() != "triggerEndpoint")
+                    m_endpointConditions.append(condition);
+
+                break;
+            }
+
+            case ConditionObject::Type::mqtt:
+            {
+                MqttCondition *item = reinterpret_cast <MqttCondition*> (condition.data());
+
+                if (item->cacheable())
+                    m_mqttConditions[item->topic()].append(condition);
+
+                break;
+            }
+
+            case ConditionObject::Type::state:
+            {
+                StateCondition *item = reinterpret_cast <StateCondition*> (condition.data());
+
+                if (item->cacheable())
+                    m_stateConditions[item->name()].append(condition);
+
+                break;
+            }
+
+            case ConditionObject::Type::AND:
+            case ConditionObject::Type::OR:
+            case ConditionObject::Type::NOT:
+                updateIndex(reinterpret_cast <NestedCondition*> (condition.data())->conditions());
+                break;
+
+            default: break;
+        }
+    }
+}
+
+void AutomationList::updateIndex(const ActionList &list)
+{
+    for (int i = 0; i < list.count(); i++)
+    {
+        const Action &action = list.at(i);
+
+        switch (action->type())
+        {
+            case ActionObject::Type::property:
+            {
+                if (reinterpret_cast <PropertyAction*> (action.data())->endpoint() != "triggerEndpoint")
+                    m_endpointActions.append(action);
+
+                break;
+            }
+
+            case ActionObject::Type::condition:
+            {
+                ConditionAction *item = reinterpret_cast <ConditionAction*> (action.data());
+                updateIndex(item->conditions());
+                updateIndex(item->actions(true));
+                updateIndex(item->actions(false));
+                break;
+            }
+
+            default: break;
+        }
+    }
+}
+
+void AutomationList::parsePattern(const QString &string)
+{
+    Pattern pattern;
+
+    if (!string.contains("{{") && !string.contains("[["))
+        return;
+
+    m_parsed.insert(string);
+
+    m_lock.lockForRead();
+    pattern = m_patterns.value(string);
+    m_lock.unlock();
+
+    if (!pattern.isNull())
+        return;
+
+    pattern = PatternObject::compile(string);
+    parsePattern(pattern);
+
+    m_lock.lockForWrite();
+    m_patterns.insert(string, pattern);
+    m_lock.unlock();
+}
+
+void AutomationList::parsePattern(const Pattern &pattern)
+{
+    if (pattern->type() == PatternObject::Type::function && !pattern->arguments().value(0).isEmpty())
+    {
+        switch (pattern->function())
+        {
+            case PatternObject::Function::file: m_files->add(pattern->arguments().value(0)); break;
+            case PatternObject::Function::mqtt: emit addSubscription(pattern->arguments().value(0)); break;
+            default: break;
+        }
+    }
+
+    for (int i = 0; i < pattern->items().count(); i++)
+        parsePattern(pattern->items().at(i));
+}
+
+void AutomationList::filePaths(const Pattern &pattern, QSet <QString> &paths)
+{
+    if (pattern->type() == PatternObject::Type::function && pattern->function() == PatternObject::Function::file && !pattern->arguments().value(0).isEmpty())
+        paths.insert(pattern->arguments().value(0));
+
+    for (int i = 0; i < pattern->items().count(); i++)
+        filePaths(pattern->items().at(i), paths);
+}
+
+void AutomationList::unserializeConditions(ConditionList &list, const QJsonArray &conditions)
 {
     for (auto it = conditions.begin(); it != conditions.end(); it++)
     {
@@ -388,6 +640,8 @@ void AutomationList::unserializeConditions(QList <Condition> &list, const QJsonA
         condition->setActive(nested ? true : item.value("active").toBool(true));
         list.append(condition);
     }
+
+    list.prepare();
 }
 
 void AutomationList::unserializeActions(ActionList &list, const QJsonArray &actions, bool add)
@@ -472,6 +726,8 @@ void AutomationList::unserializeActions(ActionList &list, const QJsonArray &acti
 
                 action = Action(new TelegramAction(message, file, item.value("keyboard").toString().trimmed(), item.value("thread").toVariant().toLongLong(), item.value("silent").toBool(), item.value("remove").toBool(), item.value("update").toBool(), chats));
                 parsePattern(message);
+                parsePattern(file);
+                parsePattern(item.value("keyboard").toString().trimmed());
                 break;
             }
 
@@ -505,6 +761,7 @@ void AutomationList::unserializeActions(ActionList &list, const QJsonArray &acti
                     continue;
 
                 action = Action(new DelayAction(value));
+                parsePattern(value.toString());
                 break;
             }
 
@@ -542,10 +799,12 @@ void AutomationList::unserialize(const QJsonArray &automations)
         if (automation.isNull())
             continue;
 
-        append(automation);
+        QList <Automation>::append(automation);
         count++;
     }
 
+    updateIndex();
+
     if (count)
         logInfo << count << "automations loaded";
 }
@@ -774,6 +1033,15 @@ QJsonArray AutomationList::serialize(void)
         if (automation->debounce())
             json.insert("debounce", automation->debounce());
 
+        if (automation->maxQueued())
+            json.insert("maxQueued", automation->maxQueued());
+
+        if (automation->maxParallel())
+            json.insert("maxParallel", automation->maxParallel());
+
+        if (automation->overflow() != AutomationObject::Overflow::dropNewest)
+            json.insert("overflow", m_overflowPolicies.valueToKey(static_cast <int> (automation->overflow())));
+
         if (automation->lastTriggered())
             json.insert("lastTriggered", automation->lastTriggered());
 
@@ -841,6 +1109,10 @@ QJsonArray AutomationList::serialize(void)
                     IntervalTrigger *trigger = reinterpret_cast <IntervalTrigger*> (automation->triggers().at(j).data());
                     item.insert("interval", QJsonValue::fromVariant(trigger->interval()));
                     item.insert("offset", QJsonValue::fromVariant(trigger->offset()));
+
+                    if (trigger->unit() != TriggerObject::Unit::minutes)
+                        item.insert("unit", m_triggerUnits.valueToKey(static_cast <int> (trigger->unit())));
+
                     break;
                 }
 
@@ -871,9 +1143,34 @@ QJsonArray AutomationList::serialize(void)
 void AutomationList::writeDatabase(void)
 {
     HOMEd *homed = reinterpret_cast <HOMEd*> (parent());
-    QJsonObject json = {{"automations", serialize()}, {"states", QJsonObject::fromVariantMap(m_states)}, {"timestamp", QDateTime::currentSecsSinceEpoch()}, {"version", SERVICE_VERSION}}, messages;
+    QMap <QString, QVariant> items = m_states.items();
+    QJsonObject json = {{"automations", serialize()}, {"timestamp", QDateTime::currentSecsSinceEpoch()}, {"version", SERVICE_VERSION}}, states, messages, queues;
+
+    for (auto it = items.begin(); it != items.end(); it++)
+    {
+        if (!it.value().isValid())
+            continue;
+
+        states.insert(it.key(), QJsonValue::fromVariant(it.value()));
+    }
+
+    json.insert("states", states);
+
+    for (int i = 0; i < count(); i++)
+    {
+        const Automation &automation = at(i);
+
+        if (!automation->peak() && !automation->shed() && automation->running().isEmpty())
+            continue;
+
+        queues.insert(automation->uuid(), QJsonObject {{"running", automation->running().count()}, {"pending", automation->pending().count()}, {"peak", automation->peak()}, {"shed", automation->shed()}});
+    }
+
+    if (!queues.isEmpty())
+        json.insert("queues", queues);
 
     homed->mqttPublishStatus(json);
+    json.remove("queues");
 
     if (!m_sync)
         return;
@@ -2,45 +2,22 @@
 #define AUTOMATION_H
 
 #define STORE_DATABASE_DELAY    20
+#define PARALLEL_QUEUE_LIMIT    64
 
 #include <QFile>
 #include <QMetaEnum>
+#include <QReadWriteLock>
 #include <QSettings>
 #include <QTimer>
 #include "action.h"
+#include "pattern.h"
+#include "topic.h"
 #include "trigger.h"
 
-class DeviceObject;
-typedef QSharedPointer <DeviceObject> Device;
-
 class AutomationObject;
+class Runner;
 typedef QSharedPointer <AutomationObject> Automation;
-
-class DeviceObject
-{
-
-public:
-
-    DeviceObject(const QString &key, const QString &topic, const QString &name) :
-        m_key(key), m_topic(topic), m_name(name) {}
-
-    inline QString key(void) { return m_key; }
-
-    inline QString topic(void) { return m_topic; }
-    inline void setTopic(const QString &value) { m_topic = value; }
-    inline void clearTopic(void) { m_topic.clear(); }
-
-    inline QString name(void) { return m_name; }
-    inline void setName(const QString &value) { m_name = value; }
-
-    inline QMap <quint8, QMap <QString, QVariant>> &properties(void) { return m_properties; }
-
-private:
-
-    QString m_key, m_topic, m_name;
-    QMap <quint8, QMap <QString, QVariant>> m_properties;
-
-};
+typedef QPair <Automation, int> TriggerReference;
 
 class AutomationObject : public QObject
 {
@@ -56,8 +33,15 @@ public:
         parallel
     };
 
+    enum class Overflow
+    {
+        dropNewest,
+        dropOldest,
+        coalesce
+    };
+
     AutomationObject(Mode mode, const QString &uuid, const QString &name, const QString &note, bool active, bool log, qint32 debounce, qint64 lastTriggered) :
-        QObject(nullptr), m_mode(mode), m_uuid(uuid), m_name(name), m_note(note), m_active(active), m_log(log), m_debounce(debounce), m_lastTriggered(lastTriggered), m_counter(1) {}
+        QObject(nullptr), m_mode(mode), m_uuid(uuid), m_name(name), m_note(note), m_active(active), m_log(log), m_debounce(debounce), m_lastTriggered(lastTriggered), m_counter(1), m_maxQueued(0), m_maxParallel(0), m_overflow(Overflow::dropNewest), m_peak(0), m_shed(0) {}
 
     inline Mode mode(void) { return m_mode; }
     inline QString uuid(void) { return m_uuid; }
@@ -75,11 +59,34 @@ public:
     inline qint64 counter(void) { return m_counter; }
     inline void updateCounter(void) { m_counter++; }
 
+    inline int maxQueued(void) { return m_maxQueued; }
+    inline int maxParallel(void) { return m_maxParallel; }
+    inline Overflow overflow(void) { return m_overflow; }
+
+    inline void setLimits(int maxQueued, int maxParallel, Overflow overflow) { m_maxQueued = maxQueued; m_maxParallel = maxParallel; m_overflow = overflow; }
+
+    inline QSet <QString> &patterns(void) { return m_patterns; }
+
+    inline QList <Runner*> &running(void) { return m_running; }
+    inline QList <Runner*> &pending(void) { return m_pending; }
+    inline QList <Runner*> &starting(void) { return m_starting; }
+
+    inline bool available(void) { return m_mode == Mode::parallel ? !m_maxParallel || m_running.count() < m_maxParallel : m_running.isEmpty(); }
+    inline int queueLimit(void) { return m_maxQueued ? m_maxQueued : m_maxParallel ? PARALLEL_QUEUE_LIMIT : 0; }
+    inline bool saturated(void) { return queueLimit() && m_pending.count() >= queueLimit(); }
+
+    inline int peak(void) { return m_peak; }
+    inline void updatePeak(void) { m_peak = qMax(m_peak, m_pending.count()); }
+
+    inline qint64 shed(void) { return m_shed; }
+    inline void updateShed(void) { m_shed++; }
+
     inline QList <Trigger> &triggers(void) { return m_triggers; }
-    inline QList <Condition> &conditions(void) { return m_conditions; }
+    inline ConditionList &conditions(void) { return m_conditions; }
     inline ActionList &actions(void) { return m_actions; }
 
     Q_ENUM(Mode)
+    Q_ENUM(Overflow)
 
 private:
 
@@ -92,8 +99,17 @@ private:
     QWeakPointer <TriggerObject> m_lastTrigger;
     qint64 m_lastTriggered, m_counter;
 
+    int m_maxQueued, m_maxParallel;
+    Overflow m_overflow;
+
+    QSet <QString> m_patterns;
+
+    QList <Runner*> m_running, m_pending, m_starting;
+    int m_peak;
+    qint64 m_shed;
+
     QList <Trigger> m_triggers;
-    QList <Condition> m_conditions;
+    ConditionList m_conditions;
     ActionList m_actions;
 
 };
@@ -108,34 +124,75 @@ public:
     ~AutomationList(void);
 
     inline QMap <QString, qint64> &messages(void) { return m_messages; }
-    inline QMap <QString, QVariant> &states(void) { return m_states; }
+    inline QVariant state(const QString &name) { return m_states.value(name); }
+    inline FileCache *files(void) { return m_files; }
+
+    inline QHash <QString, QList <TriggerReference>> propertyTriggers(const QString &endpoint) { return m_propertyTriggers.value(endpoint); }
+    inline QList <TriggerReference> mqttTriggers(const QString &topic) { return m_mqttTriggers.match(topic); }
+
+    inline void invalidateProperty(const QString &property) { invalidate(m_propertyConditions.value(property)); }
+    inline void invalidateState(const QString &name) { invalidate(m_stateConditions.value(name)); }
+    inline void invalidateTopic(const QString &topic) { invalidate(m_mqttConditions.value(topic)); }
+
+    void invalidateProperties(void);
+    bool updateState(const QString &name, const QVariant &value);
+
+    inline QList <Condition> &endpointConditions(void) { return m_endpointConditions; }
+    inline QList <Action> &endpointActions(void) { return m_endpointActions; }
+
+    Pattern pattern(const QString &string);
 
     void init(void);
     void store(bool sync = false);
 
     AutomationObject::Mode getMode(const QJsonObject &json);
+    AutomationObject::Overflow getOverflow(const QJsonObject &json);
 
     Automation byUuid(const QString &uuid, int *index = nullptr);
     Automation byName(const QString &name);
     Automation parse(const QJsonObject &json, bool add = false);
 
+    void append(const Automation &automation);
+    void replace(int index, const Automation &automation);
+    void removeAt(int index);
+
 private:
 
     QTimer *m_timer;
+    FileCache *m_files;
 
-    QMetaEnum m_automationModes, m_triggerTypes, m_conditionTypes, m_actionTypes, m_triggerStatements, m_conditionStatements, m_actionStatements;
+    QMetaEnum m_automationModes, m_overflowPolicies, m_triggerTypes, m_conditionTypes, m_actionTypes, m_triggerStatements, m_conditionStatements, m_actionStatements, m_triggerUnits;
     QFile m_file;
     qint64 m_telegramChat;
     bool m_sync;
 
     QList <QString> m_telegramActions;
     QMap <QString, qint64> m_messages;
-    QMap <QString, QVariant> m_states;
+    SnapshotHash <QString, QVariant> m_states;
+
+    QHash <QString, QHash <QString, QList <TriggerReference>>> m_propertyTriggers;
+    TopicTree <TriggerReference> m_mqttTriggers;
+
+    QHash <QString, QList <Condition>> m_propertyConditions, m_stateConditions, m_mqttConditions;
+
+    QList <Condition> m_endpointConditions;
+    QList <Action> m_endpointActions;
+
+    QReadWriteLock m_lock;
+    QHash <QString, Pattern> m_patterns;
+    QSet <QString> m_parsed;
 
     QByteArray randomData(int length);
+    void invalidate(const QList <Condition> &list);
+
+    void updateIndex(void);
+    void updateIndex(const ConditionList &list);
+    void updateIndex(const ActionList &list);
     void parsePattern(const QString &string);
+    void parsePattern(const Pattern &pattern);
+    void filePaths(const Pattern &pattern, QSet <QString> &paths);
 
-    void unserializeConditions(QList <Condition> &list, const QJsonArray &conditions);
+    void unserializeConditions(ConditionList &list, const QJsonArray &conditions);
     void unserializeActions(ActionList &list, const QJsonArray &actions, bool add);
     void unserialize(const QJsonArray &automations);
 
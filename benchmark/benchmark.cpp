@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <QCoreApplication>
+#include "benchmark.h"
+
+void Job::start(QThread *thread)
+{
+    moveToThread(thread);
+    QMetaObject::invokeMethod(this, &Job::run, Qt::QueuedConnection);
+}
+
+void Job::run(void)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    while (timer.nsecsElapsed() < BENCHMARK_SEGMENT * 1000);
+
+    m_benchmark->enqueue(this);
+}
+
+Benchmark::Benchmark(int workers, bool global, QObject *parent) : QObject(parent), m_executor(new Executor(workers, this)), m_probe(new QTimer(this)), m_drain(false), m_last(0), m_lateness(0), m_worst(0), m_samples(0), m_dispatch(0), m_duration(0), m_begin(0), m_workers(workers), m_round(0), m_pending(0), m_global(global)
+{
+    connect(m_probe, &QTimer::timeout, this, &Benchmark::probe);
+
+    m_clock.start();
+    m_probe->setTimerType(Qt::PreciseTimer);
+    m_probe->start(BENCHMARK_PROBE_INTERVAL);
+
+    QTimer::singleShot(BENCHMARK_PAUSE, this, &Benchmark::burst);
+}
+
+void Benchmark::enqueue(Job *job)
+{
+    m_outbound.push(job);
+
+    if (m_drain.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(this, &Benchmark::drain, Qt::QueuedConnection);
+}
+
+void Benchmark::dispatch(Job *job)
+{
+    QList <Job*> &list = m_starting[job->sequence()];
+
+    list.append(job);
+
+    if (list.count() > 1)
+        return;
+
+    job->start(m_executor->worker());
+}
+
+void Benchmark::report(void)
+{
+    printf("workers: %d, ordering: %s\n", m_workers, m_global ? "global" : "per automation");
+    printf("rounds: %d, burst: %d triggers over %d automations\n", BENCHMARK_ROUNDS, BENCHMARK_BURST, BENCHMARK_AUTOMATIONS);
+    printf("dispatch: %.3f ms per burst\n", m_dispatch / 1e6 / BENCHMARK_ROUNDS);
+    printf("completion: %.3f ms per burst\n", m_duration / 1e6 / BENCHMARK_ROUNDS);
+    printf("main loop lateness: %.3f ms average, %.3f ms worst over %lld samples\n", m_samples ? m_lateness / 1e6 / m_samples : 0.0, m_worst / 1e6, m_samples);
+
+    QCoreApplication::quit();
+}
+
+void Benchmark::burst(void)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    m_begin = m_clock.nsecsElapsed();
+    m_pending = BENCHMARK_BURST;
+
+    for (int i = 0; i < BENCHMARK_BURST; i++)
+        dispatch(new Job(this, m_global ? 0 : i % BENCHMARK_AUTOMATIONS));
+
+    m_dispatch += timer.nsecsElapsed();
+}
+
+void Benchmark::drain(void)
+{
+    Job *job;
+
+    m_drain = false;
+
+    while (m_outbound.pop(job))
+    {
+        QList <Job*> &list = m_starting[job->sequence()];
+
+        list.removeOne(job);
+        job->deleteLater();
+
+        if (!list.isEmpty())
+            list.first()->start(m_executor->worker());
+
+        if (--m_pending)
+            continue;
+
+        m_duration += m_clock.nsecsElapsed() - m_begin;
+
+        if (++m_round < BENCHMARK_ROUNDS)
+        {
+            QTimer::singleShot(BENCHMARK_PAUSE, this, &Benchmark::burst);
+            continue;
+        }
+
+        report();
+    }
+}
+
+void Benchmark::probe(void)
+{
+    qint64 now = m_clock.nsecsElapsed(), lateness = now - m_last - BENCHMARK_PROBE_INTERVAL * 1000000;
+
+    if (m_last && m_pending)
+    {
+        m_lateness += qMax <qint64> (lateness, 0);
+        m_worst = qMax(m_worst, lateness);
+        m_samples++;
+    }
+
+    m_last = now;
+}
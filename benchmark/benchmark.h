@@ -0,0 +1,77 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#define BENCHMARK_AUTOMATIONS       16
+#define BENCHMARK_BURST             256
+#define BENCHMARK_ROUNDS            20
+#define BENCHMARK_SEGMENT           200
+#define BENCHMARK_PROBE_INTERVAL    1
+#define BENCHMARK_PAUSE             50
+
+#include <atomic>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "executor.h"
+#include "queue.h"
+
+class Benchmark;
+
+class Job : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Job(Benchmark *benchmark, int sequence) : QObject(nullptr), m_benchmark(benchmark), m_sequence(sequence) {}
+
+    inline int sequence(void) { return m_sequence; }
+
+    void start(QThread *thread);
+
+private:
+
+    Benchmark *m_benchmark;
+    int m_sequence;
+
+private slots:
+
+    void run(void);
+
+};
+
+class Benchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Benchmark(int workers, bool global, QObject *parent);
+
+    void enqueue(Job *job);
+
+private:
+
+    Executor *m_executor;
+    QTimer *m_probe;
+    QElapsedTimer m_clock;
+
+    QList <Job*> m_starting[BENCHMARK_AUTOMATIONS];
+    Queue <Job*> m_outbound;
+    std::atomic <bool> m_drain;
+
+    qint64 m_last, m_lateness, m_worst, m_samples, m_dispatch, m_duration, m_begin;
+    int m_workers, m_round, m_pending;
+    bool m_global;
+
+    void dispatch(Job *job);
+    void report(void);
+
+private slots:
+
+    void burst(void);
+    void drain(void);
+    void probe(void);
+
+};
+
+#endif
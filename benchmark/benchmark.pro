@@ -0,0 +1,14 @@
+QT = core
+CONFIG += console c++11
+TARGET = homed-automation-benchmark
+INCLUDEPATH += ..
+
+HEADERS += \
+    ../executor.h \
+    ../queue.h \
+    benchmark.h
+
+SOURCES += \
+    ../executor.cpp \
+    benchmark.cpp \
+    main.cpp
@@ -0,0 +1,9 @@
+#include <QCoreApplication>
+#include "benchmark.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    Benchmark benchmark(argc > 1 ? QString(argv[1]).toInt() : QThread::idealThreadCount(), argc > 2 && QString(argv[2]) == "global", nullptr);
+    return application.exec();
+}
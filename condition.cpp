@@ -1,44 +1,92 @@
+#include <algorithm>
 #include "condition.h"
 #include "controller.h"
 
-bool ConditionObject::match(const QVariant &value, QVariant match, Statement statement)
+void ConditionList::prepare(void)
 {
-    if (value.type() == QVariant::Bool && match.type() == QVariant::String)
-    {
-        QList <QString> list = {"detected", "low", "occupied", "on", "open", "wet"};
-        match = list.contains(match.toString());
-    }
-    else if (match.isNull() || match.toString() == EMPTY_PATTERN_VALUE)
-        match = QVariant();
+    m_queue = *this;
+    std::stable_sort(m_queue.begin(), m_queue.end(), [] (const Condition &a, const Condition &b) { return cost(a) < cost(b); });
+}
 
-    switch (statement)
+int ConditionList::cost(const Condition &condition)
+{
+    switch (condition->type())
     {
-        case Statement::equals:  return value == match;
-        case Statement::differs: return value != match;
-        case Statement::above:   return value.toDouble() >= match.toDouble();
-        case Statement::below:   return value.toDouble() <= match.toDouble();
+        case ConditionObject::Type::date:
+        case ConditionObject::Type::time:
+        case ConditionObject::Type::week:
+            return 0;
 
-        case Statement::between:
-        {
-            QList <QVariant> list = match.toList();
-            return value.toDouble() >= qMin(list.value(0).toDouble(), list.value(1).toDouble()) && value.toDouble() <= qMax(list.value(0).toDouble(), list.value(1).toDouble());
-        }
+        case ConditionObject::Type::property:
+        case ConditionObject::Type::state:
+            return condition->dynamic() ? 3 : 1;
 
-        case Statement::outside:
+        case ConditionObject::Type::mqtt:
+            return condition->dynamic() ? 3 : 2;
+
+        case ConditionObject::Type::pattern:
+            return 3;
+
+        case ConditionObject::Type::AND:
+        case ConditionObject::Type::OR:
+        case ConditionObject::Type::NOT:
         {
-            QList <QVariant> list = match.toList();
-            return value.toDouble() < qMin(list.value(0).toDouble(), list.value(1).toDouble()) || value.toDouble() > qMax(list.value(0).toDouble(), list.value(1).toDouble());
+            QList <Condition> &list = reinterpret_cast <NestedCondition*> (condition.data())->conditions();
+            int value = 0;
+
+            for (int i = 0; i < list.count(); i++)
+                value = qMax(value, cost(list.at(i)));
+
+            return value;
         }
     }
 
+    return 0;
+}
+
+void ConditionObject::compile(const QVariant &value, bool cacheable)
+{
+    QString string = value.toString();
+
+    if (value.type() == QVariant::String && (string.contains("{{") || string.contains("[[")))
+    {
+        m_dynamic = true;
+        return;
+    }
+
+    m_cacheable = cacheable;
+    m_compiled = StatementValue(value.type() == QVariant::String ? Parser::stringValue(string) : value, true);
+}
+
+bool ConditionObject::match(const QVariant &value, const StatementValue &match, Statement statement)
+{
+    const StatementValue &item = match.select(value);
+
+    switch (statement)
+    {
+        case Statement::equals:  return value == item.value();
+        case Statement::differs: return value != item.value();
+        case Statement::above:   return value.toDouble() >= item.number();
+        case Statement::below:   return value.toDouble() <= item.number();
+        case Statement::between: return value.toDouble() >= item.min() && value.toDouble() <= item.max();
+        case Statement::outside: return value.toDouble() < item.min() || value.toDouble() > item.max();
+    }
+
     return false;
 }
 
+DateCondition::DateCondition(Statement statement, const QVariant &value) : ConditionObject(Type::date), m_statement(statement), m_value(value)
+{
+    QList <QVariant> list = m_value.toList();
+    m_start = QDate::fromString(list.value(0).toString(), "d.M");
+    m_end = QDate::fromString(list.value(1).toString(), "d.M");
+}
+
 bool DateCondition::match(const QDate &value)
 {
     QDate match;
 
-    if (m_statement != Statement::between)
+    if (m_statement != Statement::between && m_statement != Statement::outside)
     {
         QList <QString> list = m_value.toString().split('.');
 
@@ -55,19 +103,8 @@ bool DateCondition::match(const QDate &value)
         case Statement::above:   return value >= match;
         case Statement::below:   return value <= match;
 
-        case Statement::between:
-        {
-            QList <QVariant> list = m_value.toList();
-            QDate start = QDate::fromString(list.value(0).toString(), "d.M"), end = QDate::fromString(list.value(1).toString(), "d.M");
-            return start > end ? value >= start || value <= end : value >= start && value <= end;
-        }
-
-        case Statement::outside:
-        {
-            QList <QVariant> list = m_value.toList();
-            QDate start = QDate::fromString(list.value(0).toString(), "d.M"), end = QDate::fromString(list.value(1).toString(), "d.M");
-            return start > end ? value < start && value > end : value < start || value > end;
-        }
+        case Statement::between: return m_start > m_end ? value >= m_start || value <= m_end : value >= m_start && value <= m_end;
+        case Statement::outside: return m_start > m_end ? value < m_start && value > m_end : value < m_start || value > m_end;
     }
 
     return false;
@@ -99,3 +136,18 @@ bool TimeCondition::match(const QTime &value, Sun *sun)
 
     return false;
 }
+
+WeekCondition::WeekCondition(const QVariant &value) : ConditionObject(Type::week), m_value(value), m_days(0)
+{
+    QList <QVariant> list = m_value.toList();
+
+    for (int i = 0; i < list.count(); i++)
+    {
+        double day = list.at(i).toDouble();
+
+        if (day != qRound(day) || day < 1 || day > 7)
+            continue;
+
+        m_days |= 1 << static_cast <int> (day);
+    }
+}
@@ -1,12 +1,32 @@
 #ifndef CONDITION_H
 #define CONDITION_H
 
+#include <atomic>
+#include "device.h"
 #include "parser.h"
+#include "statement.h"
 #include "sun.h"
 
 class ConditionObject;
 typedef QSharedPointer <ConditionObject> Condition;
 
+class ConditionList : public QList <Condition>
+{
+
+public:
+
+    inline QList <Condition> &queue(void) { return m_queue; }
+
+    void prepare(void);
+
+private:
+
+    QList <Condition> m_queue;
+
+    static int cost(const Condition &condition);
+
+};
+
 class ConditionObject : public QObject
 {
     Q_OBJECT
@@ -38,24 +58,40 @@ public:
     };
 
     ConditionObject(Type type) :
-        QObject(nullptr), m_type(type) {}
+        QObject(nullptr), m_type(type), m_dynamic(false), m_cacheable(false), m_version(1), m_cache(0) {}
 
     inline Type type(void) { return m_type; }
 
     inline bool active(void) { return m_active; }
     inline void setActive(bool value) { m_active = value; }
 
+    inline bool dynamic(void) { return m_dynamic; }
+    inline const StatementValue &compiled(void) { return m_compiled; }
+
+    inline bool cacheable(void) { return m_cacheable; }
+    inline quint32 version(void) { return m_version; }
+    inline void invalidate(void) { m_version++; }
+
+    inline bool cached(quint32 version, bool &result) { quint64 value = m_cache; result = value & 1; return value >> 1 == version; }
+    inline void setCached(quint32 version, bool result) { m_cache = static_cast <quint64> (version) << 1 | result; }
+
     Q_ENUM(Type)
     Q_ENUM(Statement)
 
 protected:
 
-    bool match(const QVariant &value, QVariant match, Statement statement);
+    void compile(const QVariant &value, bool cacheable = true);
+    bool match(const QVariant &value, const StatementValue &match, Statement statement);
 
 private:
 
     Type m_type;
-    bool m_active;
+    bool m_active, m_dynamic, m_cacheable;
+
+    std::atomic <quint32> m_version;
+    std::atomic <quint64> m_cache;
+
+    StatementValue m_compiled;
 
 };
 
@@ -65,21 +101,28 @@ class PropertyCondition : public ConditionObject
 public:
 
     PropertyCondition(const QString &endpoint, const QString &property, Statement statement, const QVariant &value) :
-        ConditionObject(Type::property), m_endpoint(endpoint), m_property(property), m_statement(statement), m_value(value) {}
+        ConditionObject(Type::property), m_endpoint(endpoint), m_property(property), m_propertyId(property != "triggerProperty" ? Symbols::id(property) : 0), m_statement(statement), m_value(value) { compile(value, endpoint != "triggerEndpoint" && property != "triggerProperty"); }
 
     inline QString endpoint(void) { return m_endpoint; }
     inline QString property(void) { return m_property; }
+    inline quint32 propertyId(void) { return m_propertyId; }
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
 
-    inline bool match(const QVariant &value, const QVariant &match) {{ return ConditionObject::match(value, match, m_statement); }}
+    inline std::shared_ptr <const DeviceBinding> binding(void) { return m_binding.load(); }
+    inline void bind(const Device &device, quint8 endpointId) { m_binding.store(DeviceBinding(device, endpointId)); }
+
+    inline bool match(const QVariant &value, const StatementValue &match) {{ return ConditionObject::match(value, match, m_statement); }}
 
 private:
 
     QString m_endpoint, m_property;
+    quint32 m_propertyId;
     Statement m_statement;
     QVariant m_value;
 
+    Snapshot <DeviceBinding> m_binding;
+
 };
 
 class MqttCondition : public ConditionObject
@@ -88,14 +131,14 @@ class MqttCondition : public ConditionObject
 public:
 
     MqttCondition(const QString &topic, const QString &property, Statement statement, const QVariant &value) :
-        ConditionObject(Type::mqtt), m_topic(topic), m_property(property), m_statement(statement), m_value(value) {}
+        ConditionObject(Type::mqtt), m_topic(topic), m_property(property), m_statement(statement), m_value(value) { compile(value); }
 
     inline QString topic(void) { return m_topic; }
     inline QString property(void) { return m_property; }
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
 
-    inline bool match(const QByteArray &value, const QVariant &match) {{ return ConditionObject::match(m_property.isEmpty() ? value.isEmpty() ? QVariant() : value : Parser::jsonValue(value, m_property), match, m_statement); }}
+    inline bool match(const QVariant &value, const StatementValue &match) {{ return ConditionObject::match(value, match, m_statement); }}
 
 private:
 
@@ -111,13 +154,13 @@ class StateCondition : public ConditionObject
 public:
 
     StateCondition(const QString &name, Statement statement, const QVariant &value) :
-        ConditionObject(Type::state), m_name(name), m_statement(statement), m_value(value) {}
+        ConditionObject(Type::state), m_name(name), m_statement(statement), m_value(value) { compile(value); }
 
     inline QString name(void) { return m_name; }
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
 
-    inline bool match(const QVariant &value, const QVariant &match) {{ return ConditionObject::match(value, match, m_statement); }}
+    inline bool match(const QVariant &value, const StatementValue &match) {{ return ConditionObject::match(value, match, m_statement); }}
 
 private:
 
@@ -132,8 +175,7 @@ class DateCondition : public ConditionObject
 
 public:
 
-    DateCondition(Statement statement, const QVariant &value) :
-        ConditionObject(Type::date), m_statement(statement), m_value(value) {}
+    DateCondition(Statement statement, const QVariant &value);
 
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
@@ -144,6 +186,7 @@ private:
 
     Statement m_statement;
     QVariant m_value;
+    QDate m_start, m_end;
 
 };
 
@@ -172,15 +215,15 @@ class WeekCondition : public ConditionObject
 
 public:
 
-    WeekCondition(const QVariant &value) :
-        ConditionObject(Type::week), m_value(value) {}
+    WeekCondition(const QVariant &value);
 
     inline QVariant value(void) { return m_value; }
-    inline bool match(int value) { return m_value.toList().contains(value); }
+    inline bool match(int value) { return m_days & (1 << value); }
 
 private:
 
     QVariant m_value;
+    quint8 m_days;
 
 };
 
@@ -190,13 +233,13 @@ class PatternCondition : public ConditionObject
 public:
 
     PatternCondition(const QString &pattern, Statement statement, const QVariant &value) :
-        ConditionObject(Type::pattern), m_pattern(pattern), m_statement(statement), m_value(value) {}
+        ConditionObject(Type::pattern), m_pattern(pattern), m_statement(statement), m_value(value) { compile(value, false); }
 
     inline QString pattern(void) { return m_pattern; }
     inline Statement statement(void) { return m_statement; }
     inline QVariant value(void) { return m_value; }
 
-    inline bool match(const QVariant &value, const QVariant &match) {{ return ConditionObject::match(value, match, m_statement); }}
+    inline bool match(const QVariant &value, const StatementValue &match) {{ return ConditionObject::match(value, match, m_statement); }}
 
 private:
 
@@ -214,12 +257,11 @@ public:
     NestedCondition(Type type) :
         ConditionObject(type) {}
 
-    inline QList <Condition> &conditions(void) { return m_conditions; }
-
+    inline ConditionList &conditions(void) { return m_conditions; }
 
 private:
 
-    QList <Condition> m_conditions;
+    ConditionList m_conditions;
 
 };
 
@@ -2,28 +2,29 @@
 #include "logger.h"
 #include "runner.h"
 
-Controller::Controller(const QString &configFile) : HOMEd(SERVICE_VERSION, configFile, true), m_timer(new QTimer(this)), m_mutex(new QMutex), m_automations(new AutomationList(getConfig(), this)), m_telegram(new Telegram(getConfig(), m_automations,  this)), m_commands(QMetaEnum::fromType <Command> ()), m_events(QMetaEnum::fromType <Event> ()), m_dateTime(QDateTime::currentDateTime()), m_startup(false)
+Controller::Controller(const QString &configFile) : HOMEd(SERVICE_VERSION, configFile, true), m_automations(new AutomationList(getConfig(), this)), m_telegram(new Telegram(getConfig(), m_automations,  this)), m_commands(QMetaEnum::fromType <Command> ()), m_events(QMetaEnum::fromType <Event> ()), m_startup(false), m_drain(false)
 {
     m_sun = new Sun(getConfig()->value("location/latitude").toDouble(), getConfig()->value("location/longitude").toDouble());
+    m_scheduler = new Scheduler(m_automations, m_sun, this);
+    m_executor = new Executor(getConfig()->value("automation/workers", QThread::idealThreadCount()).toInt(), this);
+    m_wheel = new TimerWheel(this);
+    m_outputLimit = getConfig()->value("automation/outputLimit", SHELL_OUTPUT_LIMIT).toInt();
+    m_evaluator = getConfig()->value("automation/shards", 0).toInt() > 0 ? new Evaluator(getConfig()->value("automation/shards").toInt(), this) : nullptr;
+    m_runnerLimit = getConfig()->value("automation/maxRunners", RUNNER_LIMIT).toInt();
     updateSun();
 
     connect(m_automations, &AutomationList::addSubscription, this, &Controller::addSubscription);
     connect(m_telegram, &Telegram::messageReceived, this, &Controller::telegramReceived);
-    connect(m_timer, &QTimer::timeout, this, &Controller::update);
+    connect(m_scheduler, &Scheduler::triggered, this, &Controller::scheduleTriggered);
+    connect(m_scheduler, &Scheduler::dayChanged, this, &Controller::update);
 
     m_automations->init();
-    m_timer->start(1000);
+    m_scheduler->update();
 }
 
 Device Controller::findDevice(const QString &search)
 {
-    QList <QString> list = search.split('/');
-
-    for (auto it = m_devices.begin(); it != m_devices.end(); it++)
-        if (search == it.value()->key() || search.startsWith(it.value()->key().append('/')) || search == it.value()->topic() || search.startsWith(it.value()->topic().append('/')) || (it.value()->key().split('/').value(0) == list.value(0).toLower().trimmed() && it.value()->name().toLower() == list.value(1).toLower().trimmed()))
-            return it.value();
-
-    return Device();
+    return m_devices.byEndpoint(search);
 }
 
 quint8 Controller::getEndpointId(const QString &endpoint)
@@ -38,490 +39,598 @@ quint8 Controller::getEndpointId(const QString &endpoint)
 
 QVariant Controller::parsePattern(QString string, const QMap <QString, QString> &meta, bool condition)
 {
-    QRegExp calculate("\\[\\[([^\\]]*)\\]\\]"), replace("\\{\\{[^\\{\\}]*\\}\\}"), split("\\s+(?=(?:[^']*['][^']*['])*[^']*$)");
-    QList <QString> valueList = {"colorTemperature", "file", "level", "mqtt", "property", "shellOutput", "state", "sunrise", "sunset", "timestamp", "triggerMessage", "triggerName", "triggerProperty", "triggerTopic"};
-    int position;
+    if (!string.contains("{{") && !string.contains("[["))
+        return Parser::stringValue(string);
+
+    string = evaluatePattern(m_automations->pattern(string), meta, condition);
 
-    if (!string.startsWith("#!"))
+    for (int i = 0; i < PATTERN_RESCAN_LIMIT && string.contains("{{"); i++)
     {
-        while ((position = calculate.indexIn(string)) != -1)
-        {
-            QString item = calculate.cap();
-            double number = Expression(parsePattern(item.mid(2, item.length() - 4), meta, condition).toString()).result();
-            string.replace(position, item.length(), QString::number(number, 'f').remove(QRegExp("0+$")).remove(QRegExp("\\.$")));
-        }
+        QString value = evaluatePattern(PatternObject::compile(string, false), meta, condition);
+
+        if (value == string)
+            break;
+
+        string = value;
     }
 
-    while ((position = replace.indexIn(string)) != -1)
-    {
-        QString capture = replace.cap(), item = capture.mid(2, capture.length() - 4).trimmed(), value;
-        QList <QString> itemList = item.split('|');
-        int index = valueList.indexOf(itemList.value(0).trimmed());
+    return Parser::stringValue(string);
+}
 
-        switch (index)
+QString Controller::evaluatePattern(const Pattern &pattern, const QMap <QString, QString> &meta, bool condition)
+{
+    switch (pattern->type())
+    {
+        case PatternObject::Type::sequence:
         {
-            case 0: // colorTemperature
-            case 2: // level
-            {
-                int min = itemList.value(1).toInt(), max = itemList.value(2).toInt();
-                double position = m_sun->position();
+            QString string;
 
-                if (!min)
-                    min = index ? 100 : 153;
+            for (int i = 0; i < pattern->items().count(); i++)
+                string.append(evaluatePattern(pattern->items().at(i), meta, condition));
 
-                if (!max)
-                    max = index ? 255 : 500;
+            return string;
+        }
 
-                value = QString::number(round(position < 1 ? min + (max - min) * position : max));
-                break;
-            }
+        case PatternObject::Type::literal:
+            return pattern->value();
 
-            case 1: // file
-            {
-                QFile file(itemList.value(1).trimmed());
+        case PatternObject::Type::calculate:
+            return pattern->calculate(Parser::stringValue(evaluatePattern(pattern->items().first(), meta, condition)).toString());
 
-                if (file.open(QFile::ReadOnly | QFile::Text))
-                {
-                    value = QString(file.readAll());
-                    file.close();
-                }
-
-                break;
-            }
+        case PatternObject::Type::function:
+        {
+            QString value = patternValue(pattern->items().isEmpty() ? pattern : PatternObject::function(evaluatePattern(pattern->items().first(), meta, condition)), meta);
+            return value.isEmpty() && !condition ? EMPTY_PATTERN_VALUE : value;
+        }
+    }
 
-            case 3: // mqtt
-            {
-                auto it = m_topics.find(itemList.value(1).trimmed());
+    return QString();
+}
 
-                if (it != m_topics.end())
-                {
-                    QString property = itemList.value(2).trimmed();
-                    value = property.isEmpty() ? it.value() : Parser::jsonValue(it.value(), property).toString();
-                }
+QString Controller::patternValue(const Pattern &pattern, const QMap <QString, QString> &meta)
+{
+    const QList <QString> &arguments = pattern->arguments();
+    QString value;
 
-                break;
-            }
+    switch (pattern->function())
+    {
+        case PatternObject::Function::colorTemperature:
+        case PatternObject::Function::level:
+        {
+            bool level = pattern->function() == PatternObject::Function::level;
+            int min = arguments.value(0).toInt(), max = arguments.value(1).toInt();
+            double position;
 
-            case 4: // property
-            {
-                QString endpoint = itemList.value(1).trimmed(), propertyName = itemList.value(2).trimmed();
-                const Device &device = findDevice(endpoint);
+            m_sunLock.lockForRead();
+            position = m_sun->position();
+            m_sunLock.unlock();
 
-                if (itemList.count() > 3)
-                    value = itemList.value(3).trimmed();
+            if (!min)
+                min = level ? 100 : 153;
 
-                if (device.isNull())
-                    break;
+            if (!max)
+                max = level ? 255 : 500;
 
-                if (propertyName != "deviceName")
-                {
-                    QString property;
-                    QMap <QString, QVariant> map;
-                    QList <QString> list = propertyName.split(0x20);
-                    quint8 endpointId = static_cast <quint8> (list.last().toInt());
+            value = QString::number(round(position < 1 ? min + (max - min) * position : max));
+            break;
+        }
 
-                    if (!endpointId)
-                        endpointId = getEndpointId(endpoint);
-                    else
-                        list.removeLast();
+        case PatternObject::Function::file:
+        {
+            value = m_automations->files()->read(arguments.value(0));
+            break;
+        }
 
-                    property = list.join(QString());
+        case PatternObject::Function::mqtt:
+        {
+            Message message = m_topics.value(arguments.value(0));
 
-                    if (!device->properties().contains(endpointId))
-                    {
-                        property.append(QString("_%1").arg(endpointId));
-                        endpointId = 0;
-                    }
+            if (!message.isNull())
+                value = message->value(arguments.value(1)).toString();
 
-                    map = device->properties().value(endpointId);
+            break;
+        }
 
-                    for (auto it = map.begin(); it != map.end(); it++)
-                    {
-                        if (it.key().compare(property, Qt::CaseInsensitive))
-                            continue;
+        case PatternObject::Function::property:
+        {
+            QString endpoint = arguments.value(0), propertyName = arguments.value(1);
+            const Device &device = findDevice(endpoint);
 
-                        value = it.value().type() == QVariant::List ? it.value().toStringList().join(',') : it.value().toString();
-                        break;
-                    }
-                }
-                else
-                    value = device->name();
+            if (arguments.count() > 2)
+                value = arguments.value(2);
 
+            if (device.isNull())
                 break;
-            }
 
-            case 5: // shellOutput
+            if (propertyName != "deviceName")
             {
-                value = meta.value("shellOutput");
-                break;
-            }
+                QString property;
+                QVariant data;
+                QList <QString> list = propertyName.split(0x20);
+                quint8 endpointId = static_cast <quint8> (list.last().toInt());
 
-            case 6: // state
-            {
-                value = m_automations->states().value(itemList.value(1).trimmed()).toString();
-                break;
-            }
+                if (!endpointId)
+                    endpointId = getEndpointId(endpoint);
+                else
+                    list.removeLast();
 
-            case 7: // sunrise
-            case 8: // sunset
-            case 9: // timestamp
-            {
-                QDateTime dateTime = QDateTime::currentDateTime();
-                QString format = itemList.value(1).trimmed();
+                property = list.join(QString());
 
-                switch (index)
+                if (!device->hasEndpoint(endpointId))
                 {
-                    case 7: dateTime.setTime(m_sun->sunrise()); break;
-                    case 8: dateTime.setTime(m_sun->sunset()); break;
+                    property.append(QString("_%1").arg(endpointId));
+                    endpointId = 0;
                 }
 
-                value = format.isEmpty() ? QString::number(dateTime.toSecsSinceEpoch()) : dateTime.toString(format);
-                break;
-            }
+                data = device->properties(endpointId).value(property, Qt::CaseInsensitive);
 
-            case 10: // triggerMessage
-            {
-                QString property = itemList.value(1).trimmed(), message = meta.value("triggerMessage");
-                value = property.isEmpty() ? message : Parser::jsonValue(message.toUtf8(), property).toString();
-                break;
-            }
-
-            case 11: // triggerName
-            {
-                value = meta.value("triggerName");
-                break;
+                if (data.isValid())
+                    value = data.type() == QVariant::List ? data.toStringList().join(',') : data.toString();
             }
+            else
+                value = device->name();
 
-            case 12: // triggerProperty
-            {
-                QString endpoint = meta.value("triggerEndpoint"), property = meta.value("triggerProperty");
-                const Device &device = findDevice(endpoint);
+            break;
+        }
 
-                if (!property.isEmpty() && !device.isNull())
-                {
-                    const QMap <QString, QVariant> &map = device->properties().value(getEndpointId(endpoint));
+        case PatternObject::Function::shellOutput:
+        {
+            value = meta.value("shellOutput");
+            break;
+        }
 
-                    for (auto it = map.begin(); it != map.end(); it++)
-                    {
-                        if (it.key() != property)
-                            continue;
+        case PatternObject::Function::state:
+        {
+            value = m_automations->state(arguments.value(0)).toString();
+            break;
+        }
 
-                        value = it.value().type() == QVariant::List ? it.value().toStringList().join(',') : it.value().toString();
-                        break;
-                    }
-                }
+        case PatternObject::Function::sunrise:
+        case PatternObject::Function::sunset:
+        case PatternObject::Function::timestamp:
+        {
+            QDateTime dateTime = QDateTime::currentDateTime();
+            QString format = arguments.value(0);
 
-                break;
-            }
+            m_sunLock.lockForRead();
 
-            case 13: // triggerTopic
+            switch (pattern->function())
             {
-                QString index = itemList.value(1).trimmed(), topic = meta.value("triggerTopic");
-                value = index.isEmpty() ? topic : topic.split('/').value(index.toInt());
-                break;
+                case PatternObject::Function::sunrise: dateTime.setTime(m_sun->sunrise()); break;
+                case PatternObject::Function::sunset: dateTime.setTime(m_sun->sunset()); break;
+                default: break;
             }
 
-            default:
-            {
-                QList <QString> list = item.split(split, Qt::SkipEmptyParts);
+            m_sunLock.unlock();
 
-                for (int i = 0; i < list.count(); i++)
-                {
-                    QString item = list.at(i);
+            value = format.isEmpty() ? QString::number(dateTime.toSecsSinceEpoch()) : dateTime.toString(format);
+            break;
+        }
 
-                    if (!item.startsWith('\'') || !item.endsWith('\''))
-                        continue;
+        case PatternObject::Function::triggerMessage:
+        {
+            QString property = arguments.value(0), message = meta.value("triggerMessage");
+            value = property.isEmpty() ? message : Parser::jsonValue(message.toUtf8(), property).toString();
+            break;
+        }
 
-                    list.replace(i, item.mid(1, item.length() - 2));
-                }
+        case PatternObject::Function::triggerName:
+        {
+            value = meta.value("triggerName");
+            break;
+        }
 
-                Parser::checkConditions(list, EMPTY_PATTERN_VALUE);
-                value = list.join(0x20);
-                break;
+        case PatternObject::Function::triggerProperty:
+        {
+            QString endpoint = meta.value("triggerEndpoint"), property = meta.value("triggerProperty");
+            const Device &device = findDevice(endpoint);
+
+            if (!property.isEmpty() && !device.isNull())
+            {
+                QVariant data = device->properties(getEndpointId(endpoint)).value(property);
+                value = data.type() == QVariant::List ? data.toStringList().join(',') : data.toString();
             }
 
+            break;
         }
 
-        string.replace(position, capture.length(), value.isEmpty() && !condition ? EMPTY_PATTERN_VALUE : value);
+        case PatternObject::Function::triggerTopic:
+        {
+            QString index = arguments.value(0), topic = meta.value("triggerTopic");
+            value = index.isEmpty() ? topic : topic.split('/').value(index.toInt());
+            break;
+        }
+
+        case PatternObject::Function::expression:
+        {
+            QList <QString> list = arguments;
+            Parser::checkConditions(list, EMPTY_PATTERN_VALUE);
+            value = list.join(0x20);
+            break;
+        }
     }
 
-    return Parser::stringValue(string);
+    return value;
 }
-
-bool Controller::checkConditions(ConditionObject::Type type, const QList <Condition> &conditions, const QMap <QString, QString> &meta)
+bool Controller::checkCondition(const Condition &item, const QMap <QString, QString> &meta)
 {
     QDateTime now = QDateTime::currentDateTime();
-    int count = 0, total = 0;
 
-    for (int i = 0; i < conditions.count(); i++)
+    switch (item->type())
     {
-        const Condition &item = conditions.at(i);
+        case ConditionObject::Type::property:
+        {
+            PropertyCondition *condition = reinterpret_cast <PropertyCondition*> (item.data());
+            QString endpoint = meta.value("triggerEndpoint");
+            bool check = condition->endpoint() == "triggerEndpoint";
+            std::shared_ptr <const DeviceBinding> binding = condition->binding();
+            Device device = check ? findDevice(endpoint) : binding->first.toStrongRef();
+            PropertyList properties;
+
+            if (device.isNull())
+                return false;
+
+            properties = device->properties(check ? getEndpointId(endpoint) : binding->second);
+            return condition->match(condition->propertyId() ? properties.value(condition->propertyId()) : properties.value(meta.value("triggerProperty")), condition->dynamic() ? StatementValue(parsePattern(condition->value().toString(), meta), true) : condition->compiled());
+        }
 
-        if (!item->active())
-            continue;
+        case ConditionObject::Type::mqtt:
+        {
+            MqttCondition *condition = reinterpret_cast <MqttCondition*> (item.data());
+            Message message = m_topics.value(condition->topic());
+            QVariant value = message.isNull() || (condition->property().isEmpty() && message->data().isEmpty()) ? QVariant() : message->value(condition->property());
 
-        switch (item->type())
+            return condition->match(value, condition->dynamic() ? StatementValue(parsePattern(condition->value().toString(), meta), true) : condition->compiled());
+        }
+
+        case ConditionObject::Type::state:
         {
-            case ConditionObject::Type::property:
-            {
-                PropertyCondition *condition = reinterpret_cast <PropertyCondition*> (item.data());
-                QString endpoint = condition->endpoint() == "triggerEndpoint" ? meta.value("triggerEndpoint") : condition->endpoint(), property = condition->property() == "triggerProperty" ? meta.value("triggerProperty") : condition->property();
-                const Device &device = findDevice(endpoint);
+            StateCondition *condition = reinterpret_cast <StateCondition*> (item.data());
 
-                if (!device.isNull() && condition->match(device->properties().value(getEndpointId(endpoint)).value(property), condition->value().type() == QVariant::String ? parsePattern(condition->value().toString(), meta) : condition->value()))
-                    count++;
+            return condition->match(m_automations->state(condition->name()), condition->dynamic() ? StatementValue(parsePattern(condition->value().toString(), meta), true) : condition->compiled());
+        }
 
-                break;
-            }
+        case ConditionObject::Type::date:
+        {
+            DateCondition *condition = reinterpret_cast <DateCondition*> (item.data());
 
-            case ConditionObject::Type::mqtt:
-            {
-                MqttCondition *condition = reinterpret_cast <MqttCondition*> (item.data());
+            return condition->match(QDate(1900, now.date().month(), now.date().day()));
+        }
 
-                if (condition->match(m_topics.value(condition->topic()), condition->value().type() == QVariant::String ? parsePattern(condition->value().toString(), meta) : condition->value()))
-                    count++;
+        case ConditionObject::Type::time:
+        {
+            TimeCondition *condition = reinterpret_cast <TimeCondition*> (item.data());
+            QReadLocker locker(&m_sunLock);
 
-                break;
-            }
+            return condition->match(QTime(now.time().hour(), now.time().minute()), m_sun);
+        }
 
-            case ConditionObject::Type::state:
-            {
-                StateCondition *condition = reinterpret_cast <StateCondition*> (item.data());
+        case ConditionObject::Type::week:
+        {
+            WeekCondition *condition = reinterpret_cast <WeekCondition*> (item.data());
 
-                if (condition->match(m_automations->states().value(condition->name()), condition->value().type() == QVariant::String ? parsePattern(condition->value().toString(), meta) : condition->value()))
-                    count++;
+            return condition->match(QDate::currentDate().dayOfWeek());
+        }
 
-                break;
-            }
+        case ConditionObject::Type::pattern:
+        {
+            PatternCondition *condition = reinterpret_cast <PatternCondition*> (item.data());
 
-            case ConditionObject::Type::date:
-            {
-                DateCondition *condition = reinterpret_cast <DateCondition*> (item.data());
+            return condition->match(parsePattern(condition->pattern(), meta), condition->dynamic() ? StatementValue(parsePattern(condition->value().toString(), meta), true) : condition->compiled());
+        }
 
-                if (condition->match(QDate(1900, now.date().month(), now.date().day())))
-                    count++;
+        case ConditionObject::Type::AND:
+        case ConditionObject::Type::OR:
+        case ConditionObject::Type::NOT:
+        {
+            NestedCondition *condition = reinterpret_cast <NestedCondition*> (item.data());
 
-                break;
-            }
+            return checkConditions(condition->type(), condition->conditions(), meta);
+        }
+    }
 
-            case ConditionObject::Type::time:
-            {
-                TimeCondition *condition = reinterpret_cast <TimeCondition*> (item.data());
+    return false;
+}
 
-                if (condition->match(QTime(now.time().hour(), now.time().minute()), m_sun))
-                    count++;
+bool Controller::checkConditions(ConditionObject::Type type, ConditionList &conditions, const QMap <QString, QString> &meta)
+{
+    bool empty = true;
 
-                break;
-            }
+    for (int i = 0; i < conditions.queue().count(); i++)
+    {
+        const Condition &item = conditions.queue().at(i);
+        quint32 version = item->version();
+        bool match;
 
-            case ConditionObject::Type::week:
-            {
-                WeekCondition *condition = reinterpret_cast <WeekCondition*> (item.data());
+        if (!item->active())
+            continue;
 
-                if (condition->match(QDate::currentDate().dayOfWeek()))
-                    count++;
+        if (!item->cacheable() || !item->cached(version, match))
+        {
+            match = checkCondition(item, meta);
 
-                break;
-            }
+            if (item->cacheable())
+                item->setCached(version, match);
+        }
 
-            case ConditionObject::Type::pattern:
-            {
-                PatternCondition *condition = reinterpret_cast <PatternCondition*> (item.data());
+        switch (type)
+        {
+            case ConditionObject::Type::AND: if (!match) return false; break;
+            case ConditionObject::Type::OR:  if (match) return true; break;
+            case ConditionObject::Type::NOT: if (match) return false; break;
+            default: return false;
+        }
 
-                if (condition->match(parsePattern(condition->pattern(), meta), condition->value().type() == QVariant::String ? parsePattern(condition->value().toString(), meta) : condition->value()))
-                    count++;
+        empty = false;
+    }
 
-                break;
-            }
+    return empty || type != ConditionObject::Type::OR;
+}
 
-            case ConditionObject::Type::AND:
-            case ConditionObject::Type::OR:
-            case ConditionObject::Type::NOT:
-            {
-                NestedCondition *condition = reinterpret_cast <NestedCondition*> (item.data());
+void Controller::abortRunners(const Automation &automation)
+{
+    for (int i = 0; i < automation->running().count(); i++)
+        automation->running().at(i)->abort();
 
-                if (checkConditions(condition->type(), condition->conditions(), meta))
-                    count++;
+    for (int i = 0; i < automation->pending().count(); i++)
+        automation->pending().at(i)->abort();
+}
 
-                break;
-            }
-        }
+void Controller::addRunner(const Automation &automation, const QMap <QString, QString> &meta, bool start)
+{
+    Runner *runner = new Runner(this, automation, meta);
 
-        total++;
-    }
+    connect(runner, &Runner::started, this, &Controller::started);
+    connect(runner, &Runner::finished, this, &Controller::finished);
 
-    if (!total)
-        return true;
+    automation->updateCounter();
+    m_runners.insert(runner);
 
-    switch (type)
+    if (!start)
     {
-        case ConditionObject::Type::AND: return count == total;
-        case ConditionObject::Type::OR:  return count != 0;
-        case ConditionObject::Type::NOT: return count == 0;
-        default: return false;
+        automation->pending().append(runner);
+        automation->updatePeak();
+        logInfo << runner << "queued";
+        return;
     }
+
+    automation->running().append(runner);
+    dispatchRunner(automation, runner);
+}
+
+void Controller::dispatchRunner(const Automation &automation, Runner *runner)
+{
+    automation->starting().append(runner);
+
+    if (automation->starting().count() > 1)
+        return;
+
+    runner->start(m_executor->worker());
 }
 
-Runner *Controller::findRunner(const Automation &automation, bool pending)
+void Controller::runAutomation(const Automation &automation, int index, QMap <QString, QString> &meta)
 {
-    for (int i = 0; i < m_runners.count(); i++)
+    const Trigger &trigger = automation->triggers().at(index);
+
+    meta.insert("triggerName", trigger->name());
+
+    if (trigger->name().isEmpty())
+    {
+        logDebug(automation->log()) << automation << "triggered by" << QString("[%1]").arg(index + 1).toUtf8().constData();
+    }
+    else
     {
-        Runner *runner = m_runners.at(i);
+        logDebug(automation->log()) << automation << "triggered by" << trigger->name();
+    }
 
-        if (runner->automation() != automation || (pending && runner->isFinished()))
-            continue;
+    if (!checkConditions(ConditionObject::Type::AND, automation->conditions(), meta))
+    {
+        logDebug(automation->log()) << automation << "conditions mismatch";
+        return;
+    }
 
-        return m_runners.at(i);
+    if (QThread::currentThread() != thread())
+    {
+        QMap <QString, QString> data = meta;
+        QMetaObject::invokeMethod(this, [this, automation, data] () { startAutomation(automation, data); }, Qt::QueuedConnection);
+        return;
     }
 
-    return nullptr;
+    startAutomation(automation, meta);
 }
 
-void Controller::abortRunners(const Automation &automation)
+void Controller::startAutomation(const Automation &automation, const QMap <QString, QString> &meta)
 {
-    for (int i = 0; i < m_runners.count(); i++)
-        if (m_runners.at(i)->automation() == automation)
-            m_runners.at(i)->abort();
-}
+    bool start = true;
 
-void Controller::addRunner(const Automation &automation, const QMap <QString, QString> &meta, bool start)
-{
-    Runner *runner = new Runner(this, automation, meta);
+    if (!m_automations->contains(automation))
+        return;
 
-    connect(runner, &Runner::publishMessage, this, &Controller::publishMessage, Qt::BlockingQueuedConnection);
-    connect(runner, &Runner::updateState, this, &Controller::updateState, Qt::BlockingQueuedConnection);
-    connect(runner, &Runner::telegramAction, this, &Controller::telegramAction, Qt::BlockingQueuedConnection);
-    connect(runner, &Runner::finished, this, &Controller::finished);
+    if (automation->debounce() * 1000 + automation->lastTriggered() > QDateTime::currentMSecsSinceEpoch())
+    {
+        logDebug(automation->log()) << automation << "debounced";
+        return;
+    }
 
-    automation->updateCounter();
-    m_runners.append(runner);
+    automation->updateLastTriggered();
+    m_automations->store();
 
-    if (!start)
+    if (automation->mode() == AutomationObject::Mode::single && !automation->running().isEmpty())
     {
-        logInfo << runner << "queued";
+        logDebug(automation->log()) << automation->running().first() << "already running";
         return;
     }
 
-    runner->start();
-    QThread::msleep(RUNNER_STARTUP_DELAY);
+    if (m_runnerLimit > 0 && m_runners.count() >= m_runnerLimit)
+    {
+        logWarning << automation << "run dropped, runner limit reached";
+        automation->updateShed();
+        return;
+    }
+
+    if (!automation->running().isEmpty() || !automation->pending().isEmpty())
+    {
+        switch (automation->mode())
+        {
+            case AutomationObject::Mode::single:   return;
+            case AutomationObject::Mode::restart:  abortRunners(automation); break;
+            case AutomationObject::Mode::queued:   start = false; break;
+            case AutomationObject::Mode::parallel: start = automation->available(); break;
+        }
+    }
+
+    if (!start && automation->saturated())
+    {
+        Runner *runner;
+
+        automation->updateShed();
+
+        switch (automation->overflow())
+        {
+            case AutomationObject::Overflow::dropNewest: logDebug(automation->log()) << automation << "run dropped, queue is full"; return;
+            case AutomationObject::Overflow::dropOldest: runner = automation->pending().takeFirst(); break;
+            case AutomationObject::Overflow::coalesce:   runner = automation->pending().takeLast(); break;
+        }
+
+        logDebug(automation->log()) << runner << "dropped, queue is full";
+        runner->abort();
+    }
+
+    addRunner(automation, meta, start);
 }
 
-void Controller::handleTrigger(TriggerObject::Type type, const QVariant &a, const QVariant &b, const QVariant &c, const QVariant &d)
+void Controller::enqueue(const OutboundAction &action)
 {
-    for (int i = 0; i < m_automations->count(); i++)
+    m_outbound.push(action);
+
+    if (m_drain.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(this, &Controller::drain, Qt::QueuedConnection);
+}
+
+void Controller::handleProperties(const QString &endpoint, const QList <PropertyChange> &changes)
+{
+    QHash <QString, QList <TriggerReference>> triggers = m_automations->propertyTriggers(endpoint);
+
+    if (triggers.isEmpty())
+        return;
+
+    if (m_evaluator)
     {
-        const Automation &automation = m_automations->at(i);
+        QVector <QHash <QString, QList <TriggerReference>>> shards(m_evaluator->count());
 
-        if (!automation->active())
-            continue;
+        for (auto it = triggers.begin(); it != triggers.end(); it++)
+            for (int i = 0; i < it.value().count(); i++)
+                shards[m_evaluator->index(it.value().at(i).first)][it.key()].append(it.value().at(i));
 
-        for (int j = 0; j < automation->triggers().count(); j++)
+        for (int i = 0; i < shards.count(); i++)
         {
-            const Trigger &trigger = automation->triggers().at(j);
-            QMap <QString, QString> meta;
-            Runner *runner = findRunner(automation);
-            bool start = true;
+            QHash <QString, QList <TriggerReference>> list = shards.at(i);
 
-            if (!trigger->active() || trigger->type() != type)
+            if (list.isEmpty())
                 continue;
 
-            switch (type)
-            {
-                case TriggerObject::Type::property:
-                {
-                    PropertyTrigger *item = reinterpret_cast <PropertyTrigger*> (trigger.data());
+            m_evaluator->post(i, [this, endpoint, changes, list] () { matchProperties(endpoint, changes, list); });
+        }
 
-                    if (item->endpoint() != a.toString() || item->property() != b.toString() || !item->match(c, d))
-                        continue;
+        return;
+    }
 
-                    meta.insert("triggerEndpoint", item->endpoint());
-                    meta.insert("triggerProperty", item->property());
-                    break;
-                }
+    matchProperties(endpoint, changes, triggers);
+}
 
-                case TriggerObject::Type::mqtt:
-                {
-                    MqttTrigger *item = reinterpret_cast <MqttTrigger*> (trigger.data());
+void Controller::handleMessage(const QString &topic, const Message &oldMessage, const Message &newMessage)
+{
+    QList <TriggerReference> list = m_automations->mqttTriggers(topic);
 
-                    if (item->topic() != a.toString() || !item->match(b.toByteArray(), c.toByteArray()))
-                        continue;
+    if (list.isEmpty())
+        return;
 
-                    meta.insert("triggerMessage", c.toString());
-                    meta.insert("triggerTopic", d.toString());
-                    break;
-                }
+    if (m_evaluator)
+    {
+        QVector <QList <TriggerReference>> shards(m_evaluator->count());
 
-                case TriggerObject::Type::telegram:
-                {
-                    TelegramTrigger *item = reinterpret_cast <TelegramTrigger*> (trigger.data());
+        for (int i = 0; i < list.count(); i++)
+            shards[m_evaluator->index(list.at(i).first)].append(list.at(i));
 
-                    if (!item->match(a.toString(), b.toLongLong()))
-                        continue;
+        for (int i = 0; i < shards.count(); i++)
+        {
+            QList <TriggerReference> references = shards.at(i);
 
-                    break;
-                }
+            if (references.isEmpty())
+                continue;
 
-                case TriggerObject::Type::time:
-                {
-                    TimeTrigger *item = reinterpret_cast <TimeTrigger*> (trigger.data());
+            m_evaluator->post(i, [this, topic, oldMessage, newMessage, references] () { matchMessage(topic, oldMessage, newMessage, references); });
+        }
 
-                    if (!item->match(a.toTime(), m_sun))
-                        continue;
+        return;
+    }
 
-                    break;
-                }
+    matchMessage(topic, oldMessage, newMessage, list);
+}
 
-                case TriggerObject::Type::interval:
-                {
-                    IntervalTrigger *item = reinterpret_cast <IntervalTrigger*> (trigger.data());
+void Controller::matchProperties(const QString &endpoint, const QList <PropertyChange> &changes, const QHash <QString, QList <TriggerReference>> &triggers)
+{
+    for (int i = 0; i < changes.count(); i++)
+    {
+        const PropertyChange &change = changes.at(i);
+        auto item = triggers.constFind(change.key);
 
-                    if (!item->match(a.toTime().msecsSinceStartOfDay() / 60000))
-                        continue;
+        if (item == triggers.constEnd())
+            continue;
 
-                    break;
-                }
+        for (int j = 0; j < item.value().count(); j++)
+        {
+            const TriggerReference &reference = item.value().at(j);
+            PropertyTrigger *trigger = reinterpret_cast <PropertyTrigger*> (reference.first->triggers().at(reference.second).data());
+            QMap <QString, QString> meta;
 
-                case TriggerObject::Type::startup: break;
-            }
+            if (!reference.first->active() || !trigger->active() || !trigger->match(change.oldValue, change.newValue))
+                continue;
 
-            meta.insert("triggerName", trigger->name());
+            meta.insert("triggerEndpoint", endpoint);
+            meta.insert("triggerProperty", change.key);
+            runAutomation(reference.first, reference.second, meta);
+        }
+    }
+}
 
-            if (trigger->name().isEmpty())
-            {
-                logDebug(automation->log()) << automation << "triggered by" << QString("[%1]").arg(j + 1).toUtf8().constData();
-            }
-            else
-            {
-                logDebug(automation->log()) << automation << "triggered by" << trigger->name();
-            }
+void Controller::matchMessage(const QString &topic, const Message &oldMessage, const Message &newMessage, const QList <TriggerReference> &list)
+{
+    for (int i = 0; i < list.count(); i++)
+    {
+        const TriggerReference &reference = list.at(i);
+        MqttTrigger *trigger = reinterpret_cast <MqttTrigger*> (reference.first->triggers().at(reference.second).data());
+        QMap <QString, QString> meta;
 
-            if (!checkConditions(ConditionObject::Type::AND, automation->conditions(), meta))
-            {
-                logDebug(automation->log()) << automation << "conditions mismatch";
-                continue;
-            }
+        if (!reference.first->active() || !trigger->active() || !trigger->match(oldMessage->value(trigger->property()), newMessage->value(trigger->property())))
+            continue;
 
-            if (automation->debounce() * 1000 + automation->lastTriggered() > QDateTime::currentMSecsSinceEpoch())
-            {
-                logDebug(automation->log()) << automation << "debounced";
-                continue;
-            }
+        meta.insert("triggerMessage", QString::fromUtf8(newMessage->data()));
+        meta.insert("triggerTopic", topic);
+        runAutomation(reference.first, reference.second, meta);
+    }
+}
 
-            automation->updateLastTriggered();
-            m_automations->store();
+void Controller::handleTrigger(TriggerObject::Type type, const QVariant &a, const QVariant &b)
+{
+    for (int i = 0; i < m_automations->count(); i++)
+    {
+        const Automation &automation = m_automations->at(i);
 
-            if (runner)
-            {
-                switch (automation->mode())
-                {
-                    case AutomationObject::Mode::single:   logDebug(automation->log()) << runner << "already running"; continue;
-                    case AutomationObject::Mode::restart:  abortRunners(automation); break;
-                    case AutomationObject::Mode::queued:   start = false; break;
-                    case AutomationObject::Mode::parallel: break;
-                }
-            }
+        if (!automation->active())
+            continue;
+
+        for (int j = 0; j < automation->triggers().count(); j++)
+        {
+            const Trigger &trigger = automation->triggers().at(j);
+            QMap <QString, QString> meta;
 
-            addRunner(automation, meta, start);
+            if (!trigger->active() || trigger->type() != type || (type == TriggerObject::Type::telegram && !reinterpret_cast <TelegramTrigger*> (trigger.data())->match(a.toString(), b.toLongLong())))
+                continue;
+
+            runAutomation(automation, j, meta);
         }
     }
 }
@@ -531,27 +640,56 @@ void Controller::publishEvent(const QString &name, Event event)
     mqttPublish(mqttTopic("event/%1").arg(serviceTopic()), {{"automation", name}, {"event", m_events.valueToKey(static_cast <int> (event))}});
 }
 
+void Controller::updateDevices(void)
+{
+    m_devices.updateIndex();
+
+    for (int i = 0; i < m_automations->endpointConditions().count(); i++)
+    {
+        PropertyCondition *condition = reinterpret_cast <PropertyCondition*> (m_automations->endpointConditions().at(i).data());
+        condition->bind(findDevice(condition->endpoint()), getEndpointId(condition->endpoint()));
+    }
+
+    for (int i = 0; i < m_automations->endpointActions().count(); i++)
+    {
+        PropertyAction *action = reinterpret_cast <PropertyAction*> (m_automations->endpointActions().at(i).data());
+        action->bind(findDevice(action->endpoint()), getEndpointId(action->endpoint()));
+    }
+
+    m_automations->invalidateProperties();
+}
+
 void Controller::updateSun(void)
 {
+    m_sunLock.lockForWrite();
+
     m_sun->setDate(QDate::currentDate());
     m_sun->setOffset(QDateTime::currentDateTime().offsetFromUtc());
 
     m_sun->updateSunrise();
     m_sun->updateSunset();
 
+    m_sunLock.unlock();
+
     logInfo << "Sunrise set to" << m_sun->sunrise().toString("hh:mm").toUtf8().constData() << "and sunset set to" << m_sun->sunset().toString("hh:mm").toUtf8().constData();
 }
 
 void Controller::quit(void)
 {
-    for (int i = 0; i < m_runners.count(); i++)
+    delete m_evaluator;
+
+    for (auto it = m_runners.begin(); it != m_runners.end(); it++)
     {
-        disconnect(m_runners.at(i), &Runner::finished, this, &Controller::finished);
-        m_runners.at(i)->abort();
-        m_runners.at(i)->wait();
-        delete m_runners.at(i);
+        disconnect(*it, nullptr, this, nullptr);
+        (*it)->abort();
     }
 
+    delete m_executor;
+    qDeleteAll(m_runners);
+
+    m_runners.clear();
+    drain();
+
     delete m_telegram;
     delete m_automations;
     HOMEd::quit();
@@ -569,6 +707,7 @@ void Controller::mqttConnected(void)
     mqttSubscribe(mqttTopic("service/#"));
 
     m_devices.clear();
+    updateDevices();
     m_automations->store();
 
     for (int i = 0; i < m_subscriptions.count(); i++)
@@ -582,25 +721,20 @@ void Controller::mqttConnected(void)
 
 void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &topic)
 {
-    QByteArray check = m_topics.value(topic.name());
     QString subTopic = topic.name().replace(0, mqttTopic().length(), QString());
     QJsonObject json = QJsonDocument::fromJson(message).object();
-    bool update = true;
 
-    for (int i = 0; i < m_subscriptions.count(); i++)
+    if (!m_filters.match(topic.name()).isEmpty())
     {
-        const QString &item = m_subscriptions.at(i);
+        Message check = m_topics.value(topic.name()), item(new MessageObject(message));
 
-        if (item.endsWith('#') ? topic.name().startsWith(item.mid(0, item.indexOf("#"))) : topic.name() == item)
-        {
-            if (update)
-            {
-                m_topics.insert(topic.name(), message);
-                update = false;
-            }
+        if (check.isNull())
+            check = Message(new MessageObject(QByteArray()));
 
-            handleTrigger(TriggerObject::Type::mqtt, item, check, message, topic.name());
-        }
+        m_topics.insert(topic.name(), item);
+
+        m_automations->invalidateTopic(topic.name());
+        handleMessage(topic.name(), check, item);
     }
 
     if (subTopic == QString("command/%1").arg(serviceTopic()))
@@ -652,6 +786,8 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
                     publishEvent(automation->name(), Event::added);
                 }
 
+                m_scheduler->update();
+                updateDevices();
                 m_automations->store(true);
                 break;
             }
@@ -667,6 +803,7 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
                     m_automations->removeAt(index);
                     logInfo << automation << "removed";
                     publishEvent(automation->name(), Event::removed);
+                    m_scheduler->update();
                     m_automations->store(true);
                 }
 
@@ -675,7 +812,7 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
 
             case Command::removeState:
             {
-                if (m_automations->states().remove(json.value("state").toString()))
+                if (m_automations->updateState(json.value("state").toString(), QVariant()))
                     m_automations->store(true);
 
                 break;
@@ -704,9 +841,10 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
 
             mqttUnsubscribe(mqttTopic("fd/%1").arg(device->topic()));
             mqttUnsubscribe(mqttTopic("fd/%1/#").arg(device->topic()));
-            device->clearTopic();
+            it.value() = Device(new DeviceObject(device->key(), QString(), device->name(), device->properties()));
         }
 
+        updateDevices();
         mqttUnsubscribe(mqttTopic("status/%1").arg(service));
     }
     else if (subTopic.startsWith("status/"))
@@ -735,7 +873,7 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
 
             if (m_devices.contains(key))
             {
-                const Device &device = m_devices.value(key);
+                Device device = m_devices.value(key);
 
                 if (device->topic() != topic)
                 {
@@ -745,11 +883,11 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
                         mqttUnsubscribe(mqttTopic("fd/%1/#").arg(device->topic()));
                     }
 
-                    device->setTopic(topic);
                     check = true;
                 }
 
-                device->setName(name);
+                if (check || device->name() != name)
+                    m_devices.insert(key, Device(new DeviceObject(key, topic, name, device->properties())));
             }
             else
             {
@@ -764,6 +902,8 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
                 mqttPublish(mqttTopic("command/%1").arg(service), {{"action", "getProperties"}, {"device", names ? name : id}, {"service", "automation"}});
             }
         }
+
+        updateDevices();
     }
     else if (subTopic.startsWith("fd/"))
     {
@@ -773,26 +913,23 @@ void Controller::mqttReceived(const QByteArray &message, const QMqttTopicName &t
         if (!device.isNull())
         {
             quint8 endpointId = getEndpointId(string);
-            QList <QString> list = {"action", "event", "scene"};
-            QMap <QString, QVariant> data = json.toVariantMap(), properties = device->properties().value(endpointId), check = properties;
-
-            properties.insert(data);
+            PropertyList properties = device->properties(endpointId);
+            QList <PropertyChange> changes;
 
-            for (auto it = properties.begin(); it != properties.end(); NULL)
+            for (auto it = json.begin(); it != json.end(); it++)
             {
-                if (list.contains(it.key().split('_').value(0)))
-                {
-                    it = properties.erase(it);
-                    continue;
-                }
+                quint32 id = Symbols::id(it.key());
+                QVariant value = it.value().toVariant();
 
-                it++;
+                changes.append({it.key(), Symbols::transient(id) ? QVariant() : properties.update(id, value), value});
             }
 
-            device->properties().insert(endpointId, properties);
+            device->setProperties(endpointId, properties);
+
+            for (int i = 0; i < changes.count(); i++)
+                m_automations->invalidateProperty(changes.at(i).key);
 
-            for (auto it = data.begin(); it != data.end(); it++)
-                handleTrigger(TriggerObject::Type::property, endpointId ? QString("%1/%2").arg(device->key()).arg(endpointId) : device->key(), it.key(), check.value(it.key()), it.value());
+            handleProperties(endpointId ? QString("%1/%2").arg(device->key()).arg(endpointId) : device->key(), changes);
         }
     }
 }
@@ -803,6 +940,7 @@ void Controller::addSubscription(const QString &topic)
         return;
 
     m_subscriptions.append(topic);
+    m_filters.insert(topic, topic);
 
     if (!mqttStatus())
         return;
@@ -815,6 +953,17 @@ void Controller::telegramReceived(const QString &message, qint64 chat)
     handleTrigger(TriggerObject::Type::telegram, message, chat);
 }
 
+void Controller::scheduleTriggered(const TriggerReference &reference)
+{
+    const Automation &automation = reference.first;
+    QMap <QString, QString> meta;
+
+    if (!automation->active() || !automation->triggers().at(reference.second)->active())
+        return;
+
+    runAutomation(automation, reference.second, meta);
+}
+
 void Controller::publishMessage(const QString &topic, const QVariant &data, bool retain)
 {
     if (data.type() == QVariant::Map)
@@ -828,48 +977,77 @@ void Controller::publishMessage(const QString &topic, const QVariant &data, bool
 
 void Controller::updateState(const QString &name, const QVariant &value)
 {
-    QVariant check = m_automations->states().value(name);
-
-    if (value.isValid())
-        m_automations->states().insert(name, value);
-    else
-        m_automations->states().remove(name);
-
-    if (check == m_automations->states().value(name))
+    if (!m_automations->updateState(name, value))
         return;
 
     m_automations->store(true);
 }
 
-void Controller::telegramAction(const QString &message, const QString &file, const QString &keyboard, const QString &uuid, qint64 thread, bool silent, bool remove, bool update, QList <qint64> *chats)
+void Controller::telegramAction(const QString &message, const QString &file, const QString &keyboard, const QString &uuid, qint64 thread, bool silent, bool remove, bool update, const QList <qint64> &chats)
 {
-    m_telegram->sendMessage(message, file, keyboard, uuid, thread, silent, remove, update, *chats);
+    m_telegram->sendMessage(message, file, keyboard, uuid, thread, silent, remove, update, chats);
 }
 
-void Controller::finished(void)
+void Controller::drain(void)
 {
-    Runner *runner = reinterpret_cast <Runner*> (sender()), *next = findRunner(runner->automation(), true);
+    OutboundAction action;
 
-    if (next)
-        next->start();
+    m_drain = false;
 
-    m_runners.removeOne(runner);
-    runner->wait();
-    delete runner;
+    while (m_outbound.pop(action))
+    {
+        action.function(this);
+
+        if (!action.resume || !m_runners.contains(action.runner))
+            continue;
+
+        action.runner->resume();
+    }
 }
 
-void Controller::update(void)
+void Controller::started(void)
 {
-    QDateTime now = QDateTime::currentDateTime();
+    Runner *runner = reinterpret_cast <Runner*> (sender());
+    Automation automation = runner->automation();
+    int index;
+
+    if (automation.isNull() || (index = automation->starting().indexOf(runner)) < 0)
+        return;
+
+    automation->starting().removeAt(index);
+
+    if (index || automation->starting().isEmpty())
+        return;
+
+    automation->starting().first()->start(m_executor->worker());
+}
+
+void Controller::finished(void)
+{
+    Runner *runner = reinterpret_cast <Runner*> (sender());
+    Automation automation = runner->automation();
+
+    m_runners.remove(runner);
+    runner->deleteLater();
+
+    if (automation.isNull())
+        return;
 
-    if (m_dateTime.date() != now.date())
-        updateSun();
+    automation->running().removeOne(runner);
+    automation->pending().removeOne(runner);
 
-    if (m_dateTime.time().minute() != now.time().minute())
+    while (!automation->pending().isEmpty() && automation->available())
     {
-        QTime time = QTime(now.time().hour(), now.time().minute());
-        handleTrigger(TriggerObject::Type::time, time);
-        handleTrigger(TriggerObject::Type::interval, time);
-        m_dateTime = now;
+        runner = automation->pending().takeFirst();
+        automation->running().append(runner);
+        dispatchRunner(automation, runner);
     }
+
+    m_automations->store();
+}
+
+void Controller::update(void)
+{
+    updateSun();
+    m_scheduler->update(true);
 }
@@ -2,14 +2,20 @@
 #define CONTROLLER_H
 
 #define SERVICE_VERSION         "2.3.9"
-#define EMPTY_PATTERN_VALUE     "_NULL_"
 #define SUBSCRIPTION_DELAY      1000
-#define RUNNER_STARTUP_DELAY    10
+#define SHELL_OUTPUT_LIMIT      65536
+#define RUNNER_LIMIT            1024
 
-#include <QMutex>
+#include <QReadWriteLock>
+#include "device.h"
+#include "evaluator.h"
+#include "executor.h"
 #include "homed.h"
+#include "queue.h"
 #include "runner.h"
+#include "scheduler.h"
 #include "telegram.h"
+#include "wheel.h"
 
 class Controller : public HOMEd
 {
@@ -36,43 +42,68 @@ public:
 
     Controller(const QString &configFile);
 
-    inline QMutex *mutex(void) { return m_mutex; }
     inline Telegram *telegram(void) { return m_telegram; }
+    inline TimerWheel *wheel(void) { return m_wheel; }
+    inline int outputLimit(void) { return m_outputLimit; }
 
     Device findDevice(const QString &search);
     quint8 getEndpointId(const QString &endpoint);
 
     QVariant parsePattern(QString string, const QMap <QString, QString> &meta, bool condition = true);
-    bool checkConditions(ConditionObject::Type type, const QList <Condition> &conditions, const QMap <QString, QString> &meta);
+    bool checkConditions(ConditionObject::Type type, ConditionList &conditions, const QMap <QString, QString> &meta);
+
+    void enqueue(const OutboundAction &action);
+
+    void publishMessage(const QString &topic, const QVariant &data, bool retain = false);
+    void updateState(const QString &name, const QVariant &value);
+    void telegramAction(const QString &message, const QString &file, const QString &keyboard, const QString &uuid, qint64 thread, bool silent, bool remove, bool update, const QList <qint64> &chats);
 
     Q_ENUM(Command)
     Q_ENUM(Event)
 
 private:
 
-    QTimer *m_timer;
-    QMutex *m_mutex;
-
     AutomationList *m_automations;
     Telegram *m_telegram;
+    Scheduler *m_scheduler;
+    Executor *m_executor;
+    Evaluator *m_evaluator;
+    TimerWheel *m_wheel;
     Sun *m_sun;
+    QReadWriteLock m_sunLock;
 
     QMetaEnum m_commands, m_events;
-    QDateTime m_dateTime;
     bool m_startup;
+    int m_outputLimit, m_runnerLimit;
 
     QList <QString> m_subscriptions;
-    QList <Runner*> m_runners;
+    TopicTree <QString> m_filters;
+    QSet <Runner*> m_runners;
 
-    QMap <QString, Device> m_devices;
-    QMap <QString, QByteArray> m_topics;
+    Queue <OutboundAction> m_outbound;
+    std::atomic <bool> m_drain;
+
+    DeviceList m_devices;
+    SnapshotHash <QString, Message> m_topics;
 
-    Runner *findRunner(const Automation &automation, bool pending = false);
     void abortRunners(const Automation &automation);
     void addRunner(const Automation &automation, const QMap <QString, QString> &meta, bool start);
+    void dispatchRunner(const Automation &automation, Runner *runner);
+
+    QString evaluatePattern(const Pattern &pattern, const QMap <QString, QString> &meta, bool condition);
+    QString patternValue(const Pattern &pattern, const QMap <QString, QString> &meta);
 
-    void handleTrigger(TriggerObject::Type type, const QVariant &a = QVariant(), const QVariant &b = QVariant(), const QVariant &c = QVariant(), const QVariant &d = QVariant());
+    bool checkCondition(const Condition &item, const QMap <QString, QString> &meta);
+    void runAutomation(const Automation &automation, int index, QMap <QString, QString> &meta);
+    void startAutomation(const Automation &automation, const QMap <QString, QString> &meta);
+
+    void handleProperties(const QString &endpoint, const QList <PropertyChange> &changes);
+    void handleMessage(const QString &topic, const Message &oldMessage, const Message &newMessage);
+    void matchProperties(const QString &endpoint, const QList <PropertyChange> &changes, const QHash <QString, QList <TriggerReference>> &triggers);
+    void matchMessage(const QString &topic, const Message &oldMessage, const Message &newMessage, const QList <TriggerReference> &list);
+    void handleTrigger(TriggerObject::Type type, const QVariant &a = QVariant(), const QVariant &b = QVariant());
     void publishEvent(const QString &name, Event event);
+    void updateDevices(void);
     void updateSun(void);
 
 public slots:
@@ -86,10 +117,10 @@ private slots:
 
     void addSubscription(const QString &topic);
     void telegramReceived(const QString &message, qint64 chat);
+    void scheduleTriggered(const TriggerReference &reference);
 
-    void publishMessage(const QString &topic, const QVariant &data, bool retain);
-    void updateState(const QString &name, const QVariant &value);
-    void telegramAction(const QString &message, const QString &file, const QString &keyboard, const QString &uuid, qint64 thread, bool silent, bool remove, bool update, QList <qint64> *chats);
+    void drain(void);
+    void started(void);
     void finished(void);
 
     void update(void);
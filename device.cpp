@@ -0,0 +1,51 @@
+#include "device.h"
+
+DeviceObject::DeviceObject(const QString &key, const QString &topic, const QString &name, const PropertyMap &properties) : m_key(key), m_topic(topic), m_name(name)
+{
+    for (auto it = properties.begin(); it != properties.end(); it++)
+        m_properties.insert(it.key(), it.value());
+}
+
+Device DeviceList::byEndpoint(const QString &endpoint)
+{
+    std::shared_ptr <const DeviceIndex> index = m_index.load();
+    QList <QString> list = endpoint.split('/');
+    QString string = endpoint;
+
+    while (true)
+    {
+        auto it = index->keys.find(string);
+        int position;
+
+        if (it != index->keys.end() || (it = index->topics.find(string)) != index->topics.end())
+            return it.value();
+
+        if ((position = string.lastIndexOf('/')) < 0)
+            break;
+
+        string.truncate(position);
+    }
+
+    return index->names.value(QPair <QString, QString> (list.value(0).toLower().trimmed(), list.value(1).toLower().trimmed()));
+}
+
+void DeviceList::updateIndex(void)
+{
+    DeviceIndex index;
+
+    for (auto it = begin(); it != end(); it++)
+    {
+        const Device &device = it.value();
+        QPair <QString, QString> name(device->key().split('/').value(0), device->name().toLower());
+
+        index.keys.insert(device->key(), device);
+
+        if (!device->topic().isEmpty() && !index.topics.contains(device->topic()))
+            index.topics.insert(device->topic(), device);
+
+        if (!index.names.contains(name))
+            index.names.insert(name, device);
+    }
+
+    m_index.store(index);
+}
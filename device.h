@@ -0,0 +1,59 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include "property.h"
+#include "snapshot.h"
+
+class DeviceObject;
+typedef QSharedPointer <DeviceObject> Device;
+typedef QMap <quint8, PropertyList> PropertyMap;
+typedef QPair <QWeakPointer <DeviceObject>, quint8> DeviceBinding;
+
+class DeviceObject
+{
+
+public:
+
+    DeviceObject(const QString &key, const QString &topic, const QString &name, const PropertyMap &properties = PropertyMap());
+
+    inline QString key(void) { return m_key; }
+    inline QString topic(void) { return m_topic; }
+    inline QString name(void) { return m_name; }
+
+    inline PropertyMap properties(void) { return m_properties.items(); }
+    inline PropertyList properties(quint8 endpointId) { return m_properties.value(endpointId); }
+
+    inline bool hasEndpoint(quint8 endpointId) { return m_properties.contains(endpointId); }
+    inline void setProperties(quint8 endpointId, const PropertyList &value) { m_properties.insert(endpointId, value); }
+
+private:
+
+    QString m_key, m_topic, m_name;
+    SnapshotHash <quint8, PropertyList> m_properties;
+
+};
+
+struct DeviceIndex
+{
+    QHash <QString, Device> keys, topics;
+    QHash <QPair <QString, QString>, Device> names;
+};
+
+class DeviceList : public QMap <QString, Device>
+{
+
+public:
+
+    Device byEndpoint(const QString &endpoint);
+    void updateIndex(void);
+
+private:
+
+    Snapshot <DeviceIndex> m_index;
+
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include "evaluator.h"
+
+void Shard::post(const std::function <void (void)> &function)
+{
+    m_queue.push(function);
+
+    if (m_pending.exchange(true))
+        return;
+
+    QMetaObject::invokeMethod(this, &Shard::drain, Qt::QueuedConnection);
+}
+
+void Shard::drain(void)
+{
+    std::function <void (void)> function;
+
+    m_pending = false;
+
+    while (m_queue.pop(function))
+        function();
+}
+
+Evaluator::Evaluator(int shards, QObject *parent) : QObject(parent)
+{
+    for (int i = 0; i < shards; i++)
+    {
+        QThread *thread = new QThread(this);
+        Shard *shard = new Shard;
+
+        thread->setObjectName(QString("shard-%1").arg(i));
+        shard->moveToThread(thread);
+        connect(thread, &QThread::finished, shard, &Shard::deleteLater);
+        thread->start();
+
+        m_threads.append(thread);
+        m_shards.append(shard);
+    }
+}
+
+Evaluator::~Evaluator(void)
+{
+    for (int i = 0; i < m_threads.count(); i++)
+        m_threads.at(i)->quit();
+
+    for (int i = 0; i < m_threads.count(); i++)
+        m_threads.at(i)->wait();
+}
@@ -0,0 +1,50 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <functional>
+#include <QThread>
+#include "automation.h"
+#include "queue.h"
+
+class Shard : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Shard(void) : QObject(nullptr), m_pending(false) {}
+
+    void post(const std::function <void (void)> &function);
+
+private:
+
+    Queue <std::function <void (void)>> m_queue;
+    std::atomic <bool> m_pending;
+
+private slots:
+
+    void drain(void);
+
+};
+
+class Evaluator : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Evaluator(int shards, QObject *parent);
+    ~Evaluator(void);
+
+    inline int count(void) { return m_shards.count(); }
+    inline int index(const Automation &automation) { return qHash(automation->uuid()) % m_shards.count(); }
+    inline void post(int index, const std::function <void (void)> &function) { m_shards.at(index)->post(function); }
+
+private:
+
+    QList <QThread*> m_threads;
+    QList <Shard*> m_shards;
+
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "executor.h"
+
+Executor::Executor(int workers, QObject *parent) : QObject(parent), m_index(0)
+{
+    if (workers < 1)
+        workers = 1;
+
+    for (int i = 0; i < workers; i++)
+    {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("worker-%1").arg(i));
+        thread->start();
+        m_workers.append(thread);
+    }
+}
+
+Executor::~Executor(void)
+{
+    for (int i = 0; i < m_workers.count(); i++)
+        m_workers.at(i)->quit();
+
+    for (int i = 0; i < m_workers.count(); i++)
+        m_workers.at(i)->wait();
+}
+
+QThread *Executor::worker(void)
+{
+    QThread *thread = m_workers.at(m_index);
+    m_index = (m_index + 1) % m_workers.count();
+    return thread;
+}
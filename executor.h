@@ -0,0 +1,24 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <QThread>
+
+class Executor : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Executor(int workers, QObject *parent);
+    ~Executor(void);
+
+    QThread *worker(void);
+
+private:
+
+    QList <QThread*> m_workers;
+    int m_index;
+
+};
+
+#endif
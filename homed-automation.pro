@@ -7,15 +7,37 @@ HEADERS += \
     automation.h \
     condition.h \
     controller.h \
+    device.h \
+    evaluator.h \
+    executor.h \
+    pattern.h \
+    process.h \
+    property.h \
+    queue.h \
     runner.h \
+    scheduler.h \
+    snapshot.h \
+    statement.h \
     telegram.h \
-    trigger.h
+    topic.h \
+    trigger.h \
+    wheel.h
 
 SOURCES += \
     action.cpp \
     automation.cpp \
     condition.cpp \
     controller.cpp \
+    device.cpp \
+    evaluator.cpp \
+    executor.cpp \
+    pattern.cpp \
+    process.cpp \
+    property.cpp \
     runner.cpp \
+    scheduler.cpp \
+    statement.cpp \
     telegram.cpp \
-    trigger.cpp
+    topic.cpp \
+    trigger.cpp \
+    wheel.cpp
@@ -0,0 +1,349 @@
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <QFileInfo>
+#include <QMetaEnum>
+#include <QRegExp>
+#include "parser.h"
+#include "pattern.h"
+
+QString PatternObject::calculate(const QString &expression)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_results.find(expression);
+
+    if (it != m_results.end())
+        return it.value();
+
+    if (m_results.count() >= PATTERN_RESULT_LIMIT)
+        m_results.clear();
+
+    return m_results.insert(expression, number(expression)).value();
+}
+
+Pattern PatternObject::compile(const QString &string, bool expressions)
+{
+    QList <Pattern> nodes;
+    return compile(string, nodes, expressions);
+}
+
+Pattern PatternObject::function(const QString &string)
+{
+    QString item = string.trimmed();
+    QList <QString> list = item.split('|');
+    int index = QMetaEnum::fromType <Function> ().keyToValue(list.value(0).trimmed().toUtf8().constData());
+    Pattern pattern(new PatternObject(Type::function, item));
+
+    pattern->m_function = index < 0 ? Function::expression : static_cast <Function> (index);
+
+    if (pattern->m_function == Function::expression)
+    {
+        pattern->m_arguments = split(item);
+        return pattern;
+    }
+
+    for (int i = 1; i < list.count(); i++)
+        pattern->m_arguments.append(list.at(i).trimmed());
+
+    return pattern;
+}
+
+Pattern PatternObject::compile(const QString &string, QList <Pattern> &nodes, bool expressions)
+{
+    QRegExp calculate("\\[\\[([^\\]]*)\\]\\]"), replace("\\{\\{[^\\{\\}]*\\}\\}");
+    QString data = string;
+    int position;
+
+    if (expressions && !data.startsWith("#!"))
+    {
+        while ((position = calculate.indexIn(data)) != -1)
+        {
+            QString item = calculate.cap(), expression;
+            Pattern pattern, content = compile(item.mid(2, item.length() - 4), nodes);
+
+            if (literal(content, expression))
+                pattern = Pattern(new PatternObject(Type::literal, number(Parser::stringValue(expression).toString())));
+            else
+            {
+                pattern = Pattern(new PatternObject(Type::calculate));
+                pattern->m_items.append(content);
+            }
+
+            data.replace(position, item.length(), QChar(static_cast <ushort> (PATTERN_PLACEHOLDER + nodes.count())));
+            nodes.append(pattern);
+        }
+    }
+
+    while ((position = replace.indexIn(data)) != -1)
+    {
+        QString item = replace.cap(), string;
+        Pattern pattern, content = sequence(item.mid(2, item.length() - 4), nodes);
+
+        if (literal(content, string))
+            pattern = function(string);
+        else
+        {
+            pattern = Pattern(new PatternObject(Type::function));
+            pattern->m_items.append(content);
+        }
+
+        data.replace(position, item.length(), QChar(static_cast <ushort> (PATTERN_PLACEHOLDER + nodes.count())));
+        nodes.append(pattern);
+    }
+
+    return sequence(data, nodes);
+}
+
+Pattern PatternObject::sequence(const QString &string, const QList <Pattern> &nodes)
+{
+    Pattern pattern(new PatternObject(Type::sequence));
+    QString literal;
+
+    for (int i = 0; i < string.length(); i++)
+    {
+        int index = string.at(i).unicode() - PATTERN_PLACEHOLDER;
+
+        if (index < 0 || index >= nodes.count())
+        {
+            literal.append(string.at(i));
+            continue;
+        }
+
+        if (!literal.isEmpty())
+        {
+            pattern->m_items.append(Pattern(new PatternObject(Type::literal, literal)));
+            literal.clear();
+        }
+
+        pattern->m_items.append(nodes.at(index));
+    }
+
+    if (!literal.isEmpty())
+        pattern->m_items.append(Pattern(new PatternObject(Type::literal, literal)));
+
+    return pattern;
+}
+
+bool PatternObject::literal(const Pattern &pattern, QString &string)
+{
+    for (int i = 0; i < pattern->m_items.count(); i++)
+    {
+        const Pattern &item = pattern->m_items.at(i);
+
+        if (item->m_type != Type::literal)
+            return false;
+
+        string.append(item->m_value);
+    }
+
+    return true;
+}
+
+QString PatternObject::number(const QString &expression)
+{
+    QString string = QString::number(Expression(expression).result(), 'f');
+
+    while (string.endsWith('0'))
+        string.chop(1);
+
+    if (string.endsWith('.'))
+        string.chop(1);
+
+    return string;
+}
+
+QList <QString> PatternObject::split(const QString &string)
+{
+    QList <QString> list;
+    int quotes = string.count('\''), start = 0;
+
+    for (int i = 0; i < string.length(); i++)
+    {
+        int end = i;
+
+        if (string.at(i) == '\'')
+        {
+            quotes--;
+            continue;
+        }
+
+        if (!string.at(i).isSpace())
+            continue;
+
+        while (end < string.length() && string.at(end).isSpace())
+            end++;
+
+        if (quotes % 2 == 0)
+        {
+            if (i > start)
+                list.append(string.mid(start, i - start));
+
+            start = end;
+        }
+
+        i = end - 1;
+    }
+
+    if (start < string.length())
+        list.append(string.mid(start));
+
+    for (int i = 0; i < list.count(); i++)
+    {
+        QString item = list.at(i);
+
+        if (!item.startsWith('\'') || !item.endsWith('\''))
+            continue;
+
+        list.replace(i, item.mid(1, item.length() - 2));
+    }
+
+    return list;
+}
+
+FileCache::FileCache(QObject *parent) : QObject(parent), m_watcher(new QFileSystemWatcher(this)), m_size(0), m_version(0)
+{
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &FileCache::fileChanged);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileCache::directoryChanged);
+}
+
+void FileCache::add(const QString &path)
+{
+    QString directory = QFileInfo(path).absolutePath();
+    QMutexLocker locker(&m_mutex);
+
+    if (m_paths.contains(path))
+        return;
+
+    m_paths.insert(path);
+
+    if (!m_watcher->directories().contains(directory))
+        m_watcher->addPath(directory);
+
+    if (!cacheable(path) || !m_watcher->addPath(path))
+        return;
+
+    m_watched.insert(path);
+}
+
+void FileCache::retain(const QSet <QString> &paths)
+{
+    QMutexLocker locker(&m_mutex);
+    QList <QString> list = m_watcher->directories();
+    QSet <QString> directories;
+
+    for (auto it = m_paths.begin(); it != m_paths.end();)
+    {
+        if (!paths.contains(*it))
+        {
+            if (m_watched.remove(*it))
+                m_watcher->removePath(*it);
+
+            invalidate(*it);
+            it = m_paths.erase(it);
+            continue;
+        }
+
+        directories.insert(QFileInfo(*it).absolutePath());
+        it++;
+    }
+
+    for (int i = 0; i < list.count(); i++)
+    {
+        if (directories.contains(list.at(i)))
+            continue;
+
+        m_watcher->removePath(list.at(i));
+    }
+}
+
+QString FileCache::read(const QString &path)
+{
+    QFile file(path);
+    QString data;
+    qint64 version;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_data.find(path);
+
+        if (it != m_data.end())
+            return it.value();
+
+        version = m_version;
+    }
+
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        return data;
+
+    data = QString(file.readAll());
+    file.close();
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (version != m_version || !m_watched.contains(path) || m_size + data.size() > FILE_CACHE_LIMIT)
+            return data;
+
+        m_data.insert(path, data);
+        m_size += data.size();
+    }
+
+    return data;
+}
+
+bool FileCache::cacheable(const QString &path)
+{
+    struct statfs data;
+
+    if (!QFileInfo(path).isFile() || statfs(path.toUtf8().constData(), &data) < 0)
+        return false;
+
+    switch (data.f_type)
+    {
+        case PROC_SUPER_MAGIC:
+        case SYSFS_MAGIC:
+        case TMPFS_MAGIC:
+        case DEBUGFS_MAGIC:
+            return false;
+    }
+
+    return true;
+}
+
+void FileCache::invalidate(const QString &path)
+{
+    auto it = m_data.find(path);
+
+    m_version++;
+
+    if (it == m_data.end())
+        return;
+
+    m_size -= it.value().size();
+    m_data.erase(it);
+}
+
+void FileCache::fileChanged(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+
+    invalidate(path);
+
+    if (QFile::exists(path) && (m_watcher->files().contains(path) || m_watcher->addPath(path)))
+        return;
+
+    m_watched.remove(path);
+}
+
+void FileCache::directoryChanged(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+
+    for (auto it = m_paths.begin(); it != m_paths.end(); it++)
+    {
+        if (m_watched.contains(*it) || QFileInfo(*it).absolutePath() != path || !cacheable(*it) || !m_watcher->addPath(*it))
+            continue;
+
+        invalidate(*it);
+        m_watched.insert(*it);
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#define EMPTY_PATTERN_VALUE     "_NULL_"
+#define PATTERN_PLACEHOLDER     0xE000
+#define PATTERN_RESULT_LIMIT    32
+#define PATTERN_RESCAN_LIMIT    8
+#define FILE_CACHE_LIMIT        1048576
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+
+class PatternObject;
+typedef QSharedPointer <PatternObject> Pattern;
+
+class PatternObject : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    enum class Type
+    {
+        sequence,
+        literal,
+        calculate,
+        function
+    };
+
+    enum class Function
+    {
+        colorTemperature,
+        file,
+        level,
+        mqtt,
+        property,
+        shellOutput,
+        state,
+        sunrise,
+        sunset,
+        timestamp,
+        triggerMessage,
+        triggerName,
+        triggerProperty,
+        triggerTopic,
+        expression
+    };
+
+    PatternObject(Type type, const QString &value = QString()) :
+        QObject(nullptr), m_type(type), m_function(Function::expression), m_value(value) {}
+
+    inline Type type(void) { return m_type; }
+    inline Function function(void) { return m_function; }
+    inline QString value(void) { return m_value; }
+
+    inline QList <QString> &arguments(void) { return m_arguments; }
+    inline QList <Pattern> &items(void) { return m_items; }
+
+    QString calculate(const QString &expression);
+
+    static Pattern compile(const QString &string, bool expressions = true);
+    static Pattern function(const QString &string);
+
+    Q_ENUM(Type)
+    Q_ENUM(Function)
+
+private:
+
+    Type m_type;
+    Function m_function;
+    QString m_value;
+
+    QList <QString> m_arguments;
+    QList <Pattern> m_items;
+
+    QMutex m_mutex;
+    QHash <QString, QString> m_results;
+
+    static Pattern compile(const QString &string, QList <Pattern> &nodes, bool expressions = true);
+    static Pattern sequence(const QString &string, const QList <Pattern> &nodes);
+    static bool literal(const Pattern &pattern, QString &string);
+    static QString number(const QString &expression);
+    static QList <QString> split(const QString &string);
+
+};
+
+class FileCache : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    FileCache(QObject *parent);
+
+    void add(const QString &path);
+    void retain(const QSet <QString> &paths);
+    QString read(const QString &path);
+
+private:
+
+    QFileSystemWatcher *m_watcher;
+    QMutex m_mutex;
+
+    QSet <QString> m_paths, m_watched;
+    QHash <QString, QString> m_data;
+    qint64 m_size, m_version;
+
+    bool cacheable(const QString &path);
+    void invalidate(const QString &path);
+
+private slots:
+
+    void fileChanged(const QString &path);
+    void directoryChanged(const QString &path);
+
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "process.h"
+
+extern char **environ;
+
+Process::Process(QObject *parent) : QObject(parent), m_timer(new QTimer(this)), m_poll(new QTimer(this)), m_notifier(nullptr), m_exit(nullptr), m_id(0), m_fd(-1), m_pidfd(-1), m_limit(0), m_timedOut(false)
+{
+    connect(m_timer, &QTimer::timeout, this, &Process::timeout);
+    connect(m_poll, &QTimer::timeout, this, &Process::poll);
+
+    m_timer->setSingleShot(true);
+}
+
+Process::~Process(void)
+{
+    if (m_id)
+    {
+        killpg(static_cast <pid_t> (m_id), SIGKILL);
+        reap(true);
+    }
+
+    if (m_pidfd >= 0)
+        close(m_pidfd);
+
+    closeOutput();
+}
+
+bool Process::start(const QString &command, quint32 timeout, int limit)
+{
+    QByteArray data = command.toUtf8();
+    char shell[] = "/bin/sh", option[] = "-c", *argv[] = {shell, option, data.data(), nullptr};
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t mask, defaults;
+    int descriptors[2], result;
+    pid_t id;
+
+    if (pipe2(descriptors, O_CLOEXEC) < 0)
+        return false;
+
+    sigemptyset(&mask);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, descriptors[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, descriptors[1], STDERR_FILENO);
+
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setsigmask(&attributes, &mask);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+
+    result = posix_spawn(&id, shell, &actions, &attributes, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(descriptors[1]);
+
+    if (result)
+    {
+        close(descriptors[0]);
+        return false;
+    }
+
+    m_id = id;
+    m_fd = descriptors[0];
+    m_limit = limit;
+
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &Process::outputReady);
+
+#ifdef SYS_pidfd_open
+    m_pidfd = static_cast <int> (syscall(SYS_pidfd_open, id, 0));
+
+    if (m_pidfd >= 0)
+    {
+        m_exit = new QSocketNotifier(m_pidfd, QSocketNotifier::Read, this);
+        connect(m_exit, &QSocketNotifier::activated, this, &Process::processExited);
+    }
+#endif
+
+    if (m_pidfd < 0)
+        m_poll->start(PROCESS_POLL_INTERVAL);
+
+    m_timer->start(timeout * 1000);
+    return true;
+}
+
+void Process::closeOutput(void)
+{
+    if (m_fd < 0)
+        return;
+
+    m_notifier->setEnabled(false);
+    m_notifier->deleteLater();
+    m_notifier = nullptr;
+
+    close(m_fd);
+    m_fd = -1;
+}
+
+bool Process::readOutput(void)
+{
+    char buffer[PROCESS_READ_SIZE];
+    ssize_t length;
+
+    while ((length = read(m_fd, buffer, sizeof(buffer))) > 0)
+    {
+        int count = m_limit > 0 ? qMin(static_cast <int> (length), m_limit - m_output.length()) : static_cast <int> (length);
+
+        if (count <= 0)
+            continue;
+
+        m_output.append(buffer, count);
+    }
+
+    return length < 0 && (errno == EAGAIN || errno == EINTR);
+}
+
+bool Process::reap(bool block)
+{
+    pid_t result;
+
+    do
+        result = waitpid(static_cast <pid_t> (m_id), nullptr, block ? 0 : WNOHANG);
+    while (result < 0 && errno == EINTR);
+
+    return result != 0;
+}
+
+void Process::complete(void)
+{
+    m_id = 0;
+    m_timer->stop();
+    m_poll->stop();
+
+    if (m_exit)
+    {
+        m_exit->setEnabled(false);
+        m_exit->deleteLater();
+        m_exit = nullptr;
+    }
+
+    if (m_fd >= 0)
+        readOutput();
+
+    closeOutput();
+    emit finished(m_output);
+}
+
+void Process::outputReady(void)
+{
+    if (readOutput())
+        return;
+
+    closeOutput();
+
+    if (m_pidfd >= 0)
+        return;
+
+    poll();
+}
+
+void Process::processExited(void)
+{
+    reap(true);
+    complete();
+}
+
+void Process::poll(void)
+{
+    if (!reap(false))
+    {
+        if (!m_poll->isActive())
+            m_poll->start(PROCESS_POLL_INTERVAL);
+
+        return;
+    }
+
+    complete();
+}
+
+void Process::timeout(void)
+{
+    m_timedOut = true;
+    killpg(static_cast <pid_t> (m_id), SIGKILL);
+
+    if (m_pidfd >= 0)
+        return;
+
+    poll();
+}
@@ -0,0 +1,54 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#define PROCESS_POLL_INTERVAL   20
+#define PROCESS_READ_SIZE       4096
+
+#include <QSocketNotifier>
+#include <QTimer>
+
+class Process : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Process(QObject *parent);
+    ~Process(void);
+
+    inline qint64 id(void) { return m_id; }
+    inline bool timedOut(void) { return m_timedOut; }
+
+    bool start(const QString &command, quint32 timeout, int limit);
+
+private:
+
+    QTimer *m_timer, *m_poll;
+    QSocketNotifier *m_notifier, *m_exit;
+
+    qint64 m_id;
+    int m_fd, m_pidfd, m_limit;
+    bool m_timedOut;
+
+    QByteArray m_output;
+
+    bool readOutput(void);
+    bool reap(bool block);
+
+    void closeOutput(void);
+    void complete(void);
+
+private slots:
+
+    void outputReady(void);
+    void processExited(void);
+    void poll(void);
+    void timeout(void);
+
+signals:
+
+    void finished(const QByteArray &output);
+
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <QHash>
+#include <QReadWriteLock>
+#include "property.h"
+
+static QReadWriteLock symbolLock;
+static QHash <QString, quint32> symbolIds;
+static QVector <QString> symbolNames(1);
+static QVector <quint32> symbolFolded(1);
+static QVector <bool> symbolTransient(1);
+
+static quint32 intern(const QString &name)
+{
+    auto it = symbolIds.find(name);
+    QString lower = name.toLower();
+    quint32 id, folded;
+
+    if (it != symbolIds.end())
+        return it.value();
+
+    folded = lower != name ? intern(lower) : static_cast <quint32> (symbolNames.count());
+    id = static_cast <quint32> (symbolNames.count());
+
+    symbolIds.insert(name, id);
+    symbolNames.append(name);
+    symbolFolded.append(folded);
+    symbolTransient.append(QList <QString> {"action", "event", "scene"}.contains(name.split('_').value(0)));
+
+    return id;
+}
+
+quint32 Symbols::id(const QString &name)
+{
+    {
+        QReadLocker locker(&symbolLock);
+        auto it = symbolIds.find(name);
+
+        if (it != symbolIds.end())
+            return it.value();
+    }
+
+    QWriteLocker locker(&symbolLock);
+    return intern(name);
+}
+
+quint32 Symbols::find(const QString &name)
+{
+    QReadLocker locker(&symbolLock);
+    return symbolIds.value(name);
+}
+
+QString Symbols::name(quint32 id)
+{
+    QReadLocker locker(&symbolLock);
+    return symbolNames.value(static_cast <int> (id));
+}
+
+quint32 Symbols::folded(quint32 id)
+{
+    QReadLocker locker(&symbolLock);
+    return symbolFolded.value(static_cast <int> (id));
+}
+
+bool Symbols::transient(quint32 id)
+{
+    QReadLocker locker(&symbolLock);
+    return symbolTransient.value(static_cast <int> (id));
+}
+
+QVariant PropertyList::value(quint32 id) const
+{
+    int i = index(id);
+    return id && i < count() && at(i).id == id ? at(i).value : QVariant();
+}
+
+QVariant PropertyList::value(const QString &name, Qt::CaseSensitivity sensitivity) const
+{
+    quint32 id;
+
+    if (sensitivity == Qt::CaseSensitive)
+        return value(Symbols::find(name));
+
+    if (!(id = Symbols::find(name.toLower())))
+        return QVariant();
+
+    for (int i = 0; i < count(); i++)
+        if (at(i).folded == id)
+            return at(i).value;
+
+    return QVariant();
+}
+
+QVariant PropertyList::update(quint32 id, const QVariant &value)
+{
+    int i = index(id);
+    QVariant check;
+
+    if (i < count() && at(i).id == id)
+    {
+        QVariant &item = operator [] (i).value;
+        check = item;
+        item = value;
+        return check;
+    }
+
+    QVector <PropertyItem>::insert(i, {id, Symbols::folded(id), value});
+    return check;
+}
+
+int PropertyList::index(quint32 id) const
+{
+    return static_cast <int> (std::lower_bound(begin(), end(), id, [] (const PropertyItem &item, quint32 id) { return item.id < id; }) - begin());
+}
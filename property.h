@@ -0,0 +1,49 @@
+#ifndef PROPERTY_H
+#define PROPERTY_H
+
+#include <QVariant>
+#include <QVector>
+
+struct PropertyChange
+{
+    QString key;
+    QVariant oldValue, newValue;
+};
+
+class Symbols
+{
+
+public:
+
+    static quint32 id(const QString &name);
+    static quint32 find(const QString &name);
+
+    static QString name(quint32 id);
+    static quint32 folded(quint32 id);
+    static bool transient(quint32 id);
+
+};
+
+struct PropertyItem
+{
+    quint32 id, folded;
+    QVariant value;
+};
+
+class PropertyList : public QVector <PropertyItem>
+{
+
+public:
+
+    QVariant value(quint32 id) const;
+    QVariant value(const QString &name, Qt::CaseSensitivity sensitivity = Qt::CaseSensitive) const;
+
+    QVariant update(quint32 id, const QVariant &value);
+
+private:
+
+    int index(quint32 id) const;
+
+};
+
+#endif
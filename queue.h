@@ -0,0 +1,57 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <atomic>
+
+template <class T>
+class Queue
+{
+
+public:
+
+    Queue(void) : m_head(new Node), m_tail(m_head.load()) {}
+
+    ~Queue(void)
+    {
+        T value;
+
+        while (pop(value));
+
+        delete m_tail;
+    }
+
+    void push(const T &value)
+    {
+        Node *node = new Node(value);
+        m_head.exchange(node, std::memory_order_acq_rel)->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T &value)
+    {
+        Node *node = m_tail->next.load(std::memory_order_acquire);
+
+        if (!node)
+            return false;
+
+        value = std::move(node->value);
+        delete m_tail;
+        m_tail = node;
+        return true;
+    }
+
+private:
+
+    struct Node
+    {
+        Node(const T &value = T()) : next(nullptr), value(value) {}
+
+        std::atomic <Node*> next;
+        T value;
+    };
+
+    std::atomic <Node*> m_head;
+    Node *m_tail;
+
+};
+
+#endif
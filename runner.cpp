@@ -1,14 +1,9 @@
 #include <csignal>
-#include <unistd.h>
 #include "controller.h"
 #include "logger.h"
 
-Runner::Runner(Controller *controller, const Automation &automation, const QMap <QString, QString> &meta) : QThread(nullptr), m_controller(controller), m_automation(automation), m_id(automation->counter()), m_processId(0), m_aborted(false), m_actions(&automation->actions()), m_meta(meta)
+Runner::Runner(Controller *controller, const Automation &automation, const QMap <QString, QString> &meta) : QObject(nullptr), m_controller(controller), m_automation(automation), m_id(automation->counter()), m_processId(0), m_delay(0), m_aborted(false), m_state(State::pending), m_released(false), m_actions(&automation->actions()), m_meta(meta)
 {
-    connect(this, &Runner::started, this, &Runner::threadStarted);
-    connect(this, &Runner::finished, this, &Runner::threadFinished);
-
-    moveToThread(this);
 }
 
 Runner::~Runner(void)
@@ -19,6 +14,23 @@ Runner::~Runner(void)
     logDebug(automation()->log()) << this << "completed";
 }
 
+void Runner::start(QThread *thread)
+{
+    m_state = State::running;
+    moveToThread(thread);
+    QMetaObject::invokeMethod(this, &Runner::run, Qt::QueuedConnection);
+}
+
+void Runner::resume(void)
+{
+    QMetaObject::invokeMethod(this, &Runner::runActions, Qt::QueuedConnection);
+}
+
+void Runner::expire(void)
+{
+    QMetaObject::invokeMethod(this, &Runner::timeout, Qt::QueuedConnection);
+}
+
 void Runner::abort(void)
 {
     if (m_processId)
@@ -29,19 +41,21 @@ void Runner::abort(void)
 
     logDebug(automation()->log()) << this << "aborted";
     m_aborted = true;
-    quit();
+    QMetaObject::invokeMethod(this, &Runner::finish, Qt::QueuedConnection);
 }
 
 void Runner::propertyMessage(PropertyAction *action, QString &topic, QVariant &message)
 {
-    QMutexLocker locker(m_controller->mutex());
-    QString endpoint = action->endpoint() == "triggerEndpoint" ? m_meta.value("triggerEndpoint") : action->endpoint(), property = action->property() == "triggerProperty" ? m_meta.value("triggerProperty") : action->property();
-    const Device &device = m_controller->findDevice(endpoint);
+    QString endpoint = m_meta.value("triggerEndpoint"), property = action->property() == "triggerProperty" ? m_meta.value("triggerProperty") : action->property();
+    bool check = action->endpoint() == "triggerEndpoint";
+    std::shared_ptr <const DeviceBinding> binding = action->binding();
+    Device device = check ? m_controller->findDevice(endpoint) : binding->first.toStrongRef();
 
     if (!device.isNull())
     {
-        quint8 endpointId = m_controller->getEndpointId(endpoint);
-        QVariant value = action->value(device->properties().value(endpointId).value(property));
+        quint8 endpointId = check ? m_controller->getEndpointId(endpoint) : binding->second;
+        PropertyList properties = device->properties(endpointId);
+        QVariant value = action->value(action->propertyId() ? properties.value(action->propertyId()) : properties.value(property));
         QString string;
 
         if (value.type() == QVariant::String)
@@ -68,16 +82,45 @@ void Runner::propertyMessage(PropertyAction *action, QString &topic, QVariant &m
 
 QVariant Runner::parsePattern(QString string)
 {
-    QMutexLocker locker(m_controller->mutex());
     return m_controller->parsePattern(string, m_meta, false);
 }
 
 bool Runner::checkConditions(ConditionAction *action)
 {
-    QMutexLocker locker(m_controller->mutex());
     return m_controller->checkConditions(action->conditionType(), action->conditions(), m_meta);
 }
 
+void Runner::enqueue(const std::function <void (Controller*)> &function, bool resume)
+{
+    m_controller->enqueue({this, function, resume});
+}
+
+void Runner::release(void)
+{
+    if (m_released)
+        return;
+
+    m_released = true;
+    emit started();
+}
+
+void Runner::finish(void)
+{
+    if (m_state == State::finished)
+        return;
+
+    release();
+
+    if (m_delay)
+    {
+        m_controller->wheel()->cancel(m_delay);
+        m_delay = 0;
+    }
+
+    m_state = State::finished;
+    emit finished();
+}
+
 void Runner::runActions(void)
 {
     for (int i = m_index.value(m_actions); i < m_actions->count(); i++)
@@ -100,7 +143,7 @@ void Runner::runActions(void)
                 propertyMessage(reinterpret_cast <PropertyAction*> (item.data()), topic, message);
 
                 if (!topic.isEmpty())
-                    emit publishMessage(topic, message);
+                    enqueue([topic, message] (Controller *controller) { controller->publishMessage(topic, message); });
 
                 break;
             }
@@ -108,43 +151,51 @@ void Runner::runActions(void)
             case ActionObject::Type::mqtt:
             {
                 MqttAction *action = reinterpret_cast <MqttAction*> (item.data());
-                emit publishMessage(action->topic(), parsePattern(action->message()).toString(), action->retain());
+                QString topic = action->topic(), message = parsePattern(action->message()).toString();
+                bool retain = action->retain();
+                enqueue([topic, message, retain] (Controller *controller) { controller->publishMessage(topic, message, retain); });
                 break;
             }
 
             case ActionObject::Type::state:
             {
                 StateAction *action = reinterpret_cast <StateAction*> (item.data());
-                emit updateState(action->name(), parsePattern(action->value().toString()));
-                break;
+                QString name = action->name();
+                QVariant value = parsePattern(action->value().toString());
+                m_index.insert(m_actions, ++i);
+                enqueue([name, value] (Controller *controller) { controller->updateState(name, value); }, true);
+                return;
             }
 
             case ActionObject::Type::telegram:
             {
                 TelegramAction *action = reinterpret_cast <TelegramAction*> (item.data());
-                emit telegramAction(parsePattern(action->message()).toString(), parsePattern(action->file()).toString(), parsePattern(action->keyboard()).toString(), action->uuid(), action->thread(), action->silent(), action->remove(), action->update(), &action->chats());
+                QString message = parsePattern(action->message()).toString(), file = parsePattern(action->file()).toString(), keyboard = parsePattern(action->keyboard()).toString(), uuid = action->uuid();
+                QList <qint64> chats = action->chats();
+                qint64 thread = action->thread();
+                bool silent = action->silent(), remove = action->remove(), update = action->update();
+                enqueue([message, file, keyboard, uuid, thread, silent, remove, update, chats] (Controller *controller) { controller->telegramAction(message, file, keyboard, uuid, thread, silent, remove, update, chats); });
                 break;
             }
 
             case ActionObject::Type::shell:
             {
-                QProcess process;
                 ShellAction *action = reinterpret_cast <ShellAction*> (item.data());
+                Process *process = new Process(this);
 
-                process.setProcessChannelMode(QProcess::MergedChannels);
-                process.start("/bin/sh", {"-c", parsePattern(action->command()).toString()});
+                connect(process, &Process::finished, this, &Runner::processFinished);
 
-                m_processId = process.processId();
-                setpgid(m_processId, 0);
-
-                if (!process.waitForFinished(action->timeout() * 1000))
+                if (!process->start(parsePattern(action->command()).toString(), action->timeout(), m_controller->outputLimit()))
                 {
-                    logDebug(automation()->log()) << this << "shell action process" << m_processId << "timed out";
-                    killpg(m_processId, SIGKILL);
+                    logWarning << this << "shell action process start failed";
+                    m_meta.insert("shellOutput", QString());
+                    delete process;
+                    break;
                 }
 
-                m_meta.insert("shellOutput", process.readAll());
-                break;
+                m_processId = process->id();
+                m_index.insert(m_actions, ++i);
+                return;
             }
 
             case ActionObject::Type::condition:
@@ -162,13 +213,13 @@ void Runner::runActions(void)
                 int delay = parsePattern(reinterpret_cast <DelayAction*> (item.data())->value().toString()).toInt();
                 logDebug(automation()->log()) << this << "timer started for" << delay << "seconds";
                 m_index.insert(m_actions, ++i);
-                m_timer->start(delay * 1000);
+                m_delay = m_controller->wheel()->schedule(this, delay * 1000);
                 return;
             }
 
             case ActionObject::Type::exit:
             {
-                quit();
+                finish();
                 return;
             }
         }
@@ -181,27 +232,32 @@ void Runner::runActions(void)
         return;
     }
 
-    quit();
+    finish();
 }
 
-void Runner::threadStarted(void)
+void Runner::run(void)
 {
     logDebug(automation()->log()) << this << "started";
-
-    m_timer = new QTimer(this);
-    connect(m_timer, &QTimer::timeout, this, &Runner::timeout);
-
-    m_timer->setSingleShot(true);
     runActions();
+    release();
 }
 
-void Runner::threadFinished(void)
+void Runner::processFinished(const QByteArray &output)
 {
-    m_timer->stop();
+    Process *process = reinterpret_cast <Process*> (sender());
+
+    if (process->timedOut())
+        logDebug(automation()->log()) << this << "shell action process" << m_processId << "timed out";
+
+    m_processId = 0;
+    m_meta.insert("shellOutput", output);
+    process->deleteLater();
+    runActions();
 }
 
 void Runner::timeout(void)
 {
+    m_delay = 0;
     logDebug(automation()->log()) << this << "timer stopped";
     runActions();
 }
@@ -2,36 +2,58 @@
 #define RUNNER_H
 
 #include <atomic>
-#include <QProcess>
+#include <functional>
 #include <QThread>
 #include "automation.h"
+#include "process.h"
 
 class Controller;
+class Runner;
 
-class Runner : public QThread
+struct OutboundAction
+{
+    Runner *runner;
+    std::function <void (Controller*)> function;
+    bool resume;
+};
+
+class Runner : public QObject
 {
     Q_OBJECT
 
 public:
 
+    enum class State
+    {
+        pending,
+        running,
+        finished
+    };
+
     Runner(Controller *controller, const Automation &automation, const QMap <QString, QString> &meta);
     ~Runner(void);
 
     inline Automation automation(void) { return m_automation; }
     inline qint64 id(void) { return m_id; }
+    inline State state(void) { return m_state; }
 
+    void start(QThread *thread);
+    void resume(void);
+    void expire(void);
     void abort(void);
 
 private:
 
-    QTimer *m_timer;
     Controller *m_controller;
 
     QWeakPointer <AutomationObject> m_automation;
     qint64 m_id;
 
     std::atomic <qint64> m_processId;
+    quint64 m_delay;
     std::atomic <bool> m_aborted;
+    std::atomic <State> m_state;
+    bool m_released;
 
     ActionList *m_actions;
 
@@ -42,19 +64,21 @@ private:
 
     QVariant parsePattern(QString string);
     bool checkConditions(ConditionAction *action);
+    void enqueue(const std::function <void (Controller*)> &function, bool resume = false);
+    void release(void);
+    void finish(void);
 
 private slots:
 
+    void run(void);
     void runActions(void);
-    void threadStarted(void);
-    void threadFinished(void);
+    void processFinished(const QByteArray &output);
     void timeout(void);
 
 signals:
 
-    void publishMessage(const QString &topic, const QVariant &data, bool retain = false);
-    void updateState(const QString &name, const QVariant &value);
-    void telegramAction(const QString &message, const QString &file, const QString &keyboard, const QString &uuid, qint64 thread, bool silent, bool remove, bool update, QList <qint64> *chats);
+    void started(void);
+    void finished(void);
 
 };
 
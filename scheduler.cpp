@@ -0,0 +1,132 @@
+#include "scheduler.h"
+
+Scheduler::Scheduler(AutomationList *automations, Sun *sun, QObject *parent) : QObject(parent), m_timer(new QTimer(this)), m_automations(automations), m_sun(sun), m_armed(0)
+{
+    connect(m_timer, &QTimer::timeout, this, &Scheduler::timeout);
+
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+}
+
+void Scheduler::update(bool rollover)
+{
+    QDateTime now = QDateTime::currentDateTime();
+    QList <TriggerObject::Type> types = {TriggerObject::Type::time, TriggerObject::Type::interval};
+    qint64 value = rollover ? 0 : now.time().msecsSinceStartOfDay() + 1;
+
+    m_date = now.date();
+    m_queue.clear();
+
+    for (int i = 0; i < types.count(); i++)
+    {
+        for (int j = 0; j < m_automations->count(); j++)
+        {
+            const Automation &automation = m_automations->at(j);
+
+            if (!automation->active())
+                continue;
+
+            for (int k = 0; k < automation->triggers().count(); k++)
+            {
+                const Trigger &trigger = automation->triggers().at(k);
+
+                if (!trigger->active() || trigger->type() != types.at(i))
+                    continue;
+
+                insert(TriggerReference(automation, k), value);
+            }
+        }
+    }
+
+    start();
+}
+
+void Scheduler::insert(const TriggerReference &reference, qint64 value)
+{
+    const Trigger &trigger = reference.first->triggers().at(reference.second);
+    qint64 time = -1;
+
+    switch (trigger->type())
+    {
+        case TriggerObject::Type::time:
+        {
+            QTime item = reinterpret_cast <TimeTrigger*> (trigger.data())->time(m_sun);
+
+            if (item.isValid())
+                time = item.msecsSinceStartOfDay();
+
+            break;
+        }
+
+        case TriggerObject::Type::interval:
+        {
+            time = reinterpret_cast <IntervalTrigger*> (trigger.data())->next(value);
+            break;
+        }
+
+        default: break;
+    }
+
+    if (time < value || time >= DAY_INTERVAL)
+        return;
+
+    m_queue[QDateTime(m_date, QTime::fromMSecsSinceStartOfDay(static_cast <int> (time))).toMSecsSinceEpoch()].append(reference);
+}
+
+void Scheduler::start(void)
+{
+    qint64 next = QDateTime(m_date.addDays(1), QTime(0, 0)).toMSecsSinceEpoch();
+
+    if (!m_queue.isEmpty() && m_queue.firstKey() < next)
+        next = m_queue.firstKey();
+
+    m_armed = QDateTime::currentMSecsSinceEpoch();
+    m_clock.start();
+    m_timer->start(static_cast <int> (qBound <qint64> (0, next - m_armed, SCHEDULER_MAX_DELAY)));
+}
+
+void Scheduler::timeout(void)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (qAbs(now - m_armed - m_clock.elapsed()) > SCHEDULER_JUMP_LIMIT)
+    {
+        if (QDate::currentDate() != m_date)
+        {
+            emit dayChanged();
+            return;
+        }
+
+        update();
+        return;
+    }
+
+    while (!m_queue.isEmpty() && m_queue.firstKey() <= now)
+    {
+        bool late = now - m_queue.firstKey() > SCHEDULER_LATE_LIMIT;
+        QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(qMax(m_queue.firstKey(), now));
+        qint64 value = dateTime.date() == m_date ? dateTime.time().msecsSinceStartOfDay() + 1 : DAY_INTERVAL;
+        QList <TriggerReference> list = m_queue.take(m_queue.firstKey());
+
+        for (int i = 0; i < list.count(); i++)
+        {
+            const TriggerReference &reference = list.at(i);
+
+            if (reference.first->triggers().at(reference.second)->type() == TriggerObject::Type::interval)
+                insert(reference, value);
+
+            if (late)
+                continue;
+
+            emit triggered(reference);
+        }
+    }
+
+    if (QDate::currentDate() != m_date)
+    {
+        emit dayChanged();
+        return;
+    }
+
+    start();
+}
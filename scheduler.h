@@ -0,0 +1,48 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#define DAY_INTERVAL            86400000
+#define SCHEDULER_MAX_DELAY     60000
+#define SCHEDULER_JUMP_LIMIT    1000
+#define SCHEDULER_LATE_LIMIT    1000
+
+#include <QElapsedTimer>
+#include "automation.h"
+
+class Scheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    Scheduler(AutomationList *automations, Sun *sun, QObject *parent);
+
+    void update(bool rollover = false);
+
+private:
+
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+
+    AutomationList *m_automations;
+    Sun *m_sun;
+
+    QDate m_date;
+    qint64 m_armed;
+    QMap <qint64, QList <TriggerReference>> m_queue;
+
+    void insert(const TriggerReference &reference, qint64 value);
+    void start(void);
+
+private slots:
+
+    void timeout(void);
+
+signals:
+
+    void triggered(const TriggerReference &reference);
+    void dayChanged(void);
+
+};
+
+#endif
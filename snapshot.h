@@ -0,0 +1,90 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <memory>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSharedPointer>
+
+template <class T>
+class Snapshot
+{
+
+public:
+
+    Snapshot(const T &value = T()) :
+        m_data(std::make_shared <const T> (value)) {}
+
+    inline std::shared_ptr <const T> load(void) const { return std::atomic_load(&m_data); }
+    inline void store(const T &value) { std::atomic_store(&m_data, std::shared_ptr <const T> (std::make_shared <const T> (value))); }
+
+private:
+
+    std::shared_ptr <const T> m_data;
+
+};
+
+template <class K, class T>
+class SnapshotHash
+{
+
+public:
+
+    T value(const K &key) const
+    {
+        QSharedPointer <Snapshot <T>> item = find(key);
+        return item.isNull() ? T() : *item->load();
+    }
+
+    bool contains(const K &key) const
+    {
+        return !find(key).isNull();
+    }
+
+    void insert(const K &key, const T &value)
+    {
+        QSharedPointer <Snapshot <T>> item = find(key);
+
+        if (item.isNull())
+        {
+            QMutexLocker locker(&m_mutex);
+            QHash <K, QSharedPointer <Snapshot <T>>> slots = *m_slots.load();
+
+            item = slots.value(key);
+
+            if (item.isNull())
+            {
+                item = QSharedPointer <Snapshot <T>> (new Snapshot <T>);
+                slots.insert(key, item);
+                m_slots.store(slots);
+            }
+        }
+
+        item->store(value);
+    }
+
+    QMap <K, T> items(void) const
+    {
+        std::shared_ptr <const QHash <K, QSharedPointer <Snapshot <T>>>> slots = m_slots.load();
+        QMap <K, T> map;
+
+        for (auto it = slots->begin(); it != slots->end(); it++)
+            map.insert(it.key(), *it.value()->load());
+
+        return map;
+    }
+
+private:
+
+    QMutex m_mutex;
+    Snapshot <QHash <K, QSharedPointer <Snapshot <T>>>> m_slots;
+
+    QSharedPointer <Snapshot <T>> find(const K &key) const
+    {
+        return m_slots.load()->value(key);
+    }
+
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "pattern.h"
+#include "statement.h"
+
+StatementValue::StatementValue(const QVariant &value, bool condition) : m_value(value)
+{
+    QList <QVariant> list;
+
+    if (value.type() == QVariant::String)
+    {
+        QList <QString> keywords = {"detected", "low", "occupied", "on", "open", "wet"};
+        m_boolean = QSharedPointer <StatementValue> (new StatementValue(keywords.contains(value.toString())));
+    }
+
+    if (condition && (value.isNull() || value.toString() == EMPTY_PATTERN_VALUE))
+        m_value = QVariant();
+
+    list = m_value.toList();
+    m_number = m_value.toDouble();
+    m_min = qMin(list.value(0).toDouble(), list.value(1).toDouble());
+    m_max = qMax(list.value(0).toDouble(), list.value(1).toDouble());
+}
@@ -0,0 +1,30 @@
+#ifndef STATEMENT_H
+#define STATEMENT_H
+
+#include <QSharedPointer>
+#include <QVariant>
+
+class StatementValue
+{
+
+public:
+
+    StatementValue(const QVariant &value = QVariant(), bool condition = false);
+
+    inline const QVariant &value(void) const { return m_value; }
+    inline double number(void) const { return m_number; }
+    inline double min(void) const { return m_min; }
+    inline double max(void) const { return m_max; }
+
+    inline const StatementValue &select(const QVariant &value) const { return value.type() == QVariant::Bool && !m_boolean.isNull() ? *m_boolean : *this; }
+
+private:
+
+    QVariant m_value;
+    double m_number, m_min, m_max;
+
+    QSharedPointer <StatementValue> m_boolean;
+
+};
+
+#endif
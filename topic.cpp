@@ -0,0 +1,15 @@
+#include "topic.h"
+
+QVariant MessageObject::value(const QString &property)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_values.find(property);
+
+    if (property.isEmpty())
+        return m_data;
+
+    if (it == m_values.end())
+        it = m_values.insert(property, Parser::jsonValue(m_data, property));
+
+    return it.value();
+}
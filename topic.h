@@ -0,0 +1,109 @@
+#ifndef TOPIC_H
+#define TOPIC_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include "parser.h"
+
+class MessageObject;
+typedef QSharedPointer <MessageObject> Message;
+
+class MessageObject
+{
+
+public:
+
+    MessageObject(const QByteArray &data) :
+        m_data(data) {}
+
+    inline QByteArray data(void) { return m_data; }
+
+    QVariant value(const QString &property);
+
+private:
+
+    QByteArray m_data;
+
+    QMutex m_mutex;
+    QHash <QString, QVariant> m_values;
+
+};
+
+template <class T>
+class TopicTree
+{
+
+public:
+
+    void insert(const QString &filter, const T &value)
+    {
+        QList <QString> list = filter.split('/');
+        TopicTree <T> *node = this;
+
+        for (int i = 0; i < list.count(); i++)
+        {
+            QSharedPointer <TopicTree <T>> &child = node->m_children[list.at(i)];
+
+            if (child.isNull())
+                child = QSharedPointer <TopicTree <T>> (new TopicTree <T>);
+
+            node = child.data();
+        }
+
+        node->m_values.append(value);
+    }
+
+    void clear(void)
+    {
+        m_children.clear();
+        m_values.clear();
+    }
+
+    QList <T> match(const QString &topic)
+    {
+        QList <T> list;
+        match(topic.split('/'), 0, list);
+        return list;
+    }
+
+private:
+
+    QHash <QString, QSharedPointer <TopicTree <T>>> m_children;
+    QList <T> m_values;
+
+    void match(const QList <QString> &levels, int index, QList <T> &list)
+    {
+        auto multi = m_children.find("#"), single = m_children.find("+");
+
+        if (index == levels.count())
+        {
+            list.append(m_values);
+
+            if (multi != m_children.end())
+                list.append(multi.value()->m_values);
+
+            return;
+        }
+
+        if (index || !levels.first().startsWith('$'))
+        {
+            if (multi != m_children.end())
+                list.append(multi.value()->m_values);
+
+            if (single != m_children.end())
+                single.value()->match(levels, index + 1, list);
+        }
+
+        auto it = m_children.find(levels.at(index));
+
+        if (it == m_children.end())
+            return;
+
+        it.value()->match(levels, index + 1, list);
+    }
+
+};
+
+#endif
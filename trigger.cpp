@@ -1,38 +1,32 @@
 #include "trigger.h"
 
-bool TriggerObject::match(const QVariant &oldValue, const QVariant &newValue, Statement statement, QVariant value, bool force)
+bool TriggerObject::match(const QVariant &oldValue, const QVariant &newValue, Statement statement, const StatementValue &value, bool force)
 {
-    if (newValue.type() == QVariant::Bool && value.type() == QVariant::String)
-    {
-        QList <QString> list = {"detected", "low", "occupied", "on", "open", "wet"};
-        value = list.contains(value.toString());
-    }
+    const StatementValue &item = value.select(newValue);
 
     switch (statement)
     {
-        case Statement::equals:  return (force || !oldValue.isValid() || oldValue != value) && newValue == value;
-        case Statement::differs: return (force || !oldValue.isValid() || oldValue == value) && newValue != value;
-        case Statement::above:   return (force || !oldValue.isValid() || oldValue.toDouble() < value.toDouble()) && newValue.toDouble() >= value.toDouble();
-        case Statement::below:   return (force || !oldValue.isValid() || oldValue.toDouble() > value.toDouble()) && newValue.toDouble() <= value.toDouble();
+        case Statement::equals:  return (force || !oldValue.isValid() || oldValue != item.value()) && newValue == item.value();
+        case Statement::differs: return (force || !oldValue.isValid() || oldValue == item.value()) && newValue != item.value();
+        case Statement::above:   return (force || !oldValue.isValid() || oldValue.toDouble() < item.number()) && newValue.toDouble() >= item.number();
+        case Statement::below:   return (force || !oldValue.isValid() || oldValue.toDouble() > item.number()) && newValue.toDouble() <= item.number();
 
         case Statement::between:
         {
-            QList <QVariant> list = value.toList();
-            double a = oldValue.toDouble(), b = newValue.toDouble(), min = qMin(list.value(0).toDouble(), list.value(1).toDouble()), max = qMax(list.value(0).toDouble(), list.value(1).toDouble());
-            return (force || !oldValue.isValid() || a < min || a > max) && b >= min && b <= max;
+            double a = oldValue.toDouble(), b = newValue.toDouble();
+            return (force || !oldValue.isValid() || a < item.min() || a > item.max()) && b >= item.min() && b <= item.max();
         }
 
         case Statement::outside:
         {
-            QList <QVariant> list = value.toList();
-            double a = oldValue.toDouble(), b = newValue.toDouble(), min = qMin(list.value(0).toDouble(), list.value(1).toDouble()), max = qMax(list.value(0).toDouble(), list.value(1).toDouble());
-            return (force || !oldValue.isValid() || (a >= min && a <= max)) && (b < min || b > max);
+            double a = oldValue.toDouble(), b = newValue.toDouble();
+            return (force || !oldValue.isValid() || (a >= item.min() && a <= item.max())) && (b < item.min() || b > item.max());
         }
 
         case Statement::changes:
         {
-            double a = oldValue.toDouble(), b = newValue.toDouble(), change = value.toDouble();
-            return a != b && (b <= a - change || b >= a + change);
+            double a = oldValue.toDouble(), b = newValue.toDouble();
+            return a != b && (b <= a - item.number() || b >= a + item.number());
         }
 
         case Statement::updates: return oldValue != newValue;
@@ -40,3 +34,27 @@ bool TriggerObject::match(const QVariant &oldValue, const QVariant &newValue, St
 
     return false;
 }
+
+QTime TimeTrigger::time(Sun *sun)
+{
+    QString value = m_time.toString().trimmed();
+    QTime time = QTime::fromString(value, "h:mm:ss.zzz");
+
+    if (!time.isValid())
+        time = QTime::fromString(value, "h:mm:ss");
+
+    return time.isValid() ? time : sun->fromString(m_time.toString());
+}
+
+qint64 IntervalTrigger::next(qint64 value)
+{
+    qint64 multiplier = m_unit == Unit::milliseconds ? 1 : m_unit == Unit::seconds ? 1000 : 60000, interval = qAbs(m_interval) * multiplier, offset = m_offset * multiplier;
+
+    if (!interval)
+        return -1;
+
+    if (value > offset)
+        offset += (value - offset + interval - 1) / interval * interval;
+
+    return offset;
+}
@@ -1,7 +1,10 @@
 #ifndef TRIGGER_H
 #define TRIGGER_H
 
+#define INTERVAL_TRIGGER_LIMIT  100
+
 #include "parser.h"
+#include "statement.h"
 #include "sun.h"
 
 class TriggerObject;
@@ -35,6 +38,13 @@ public:
         updates
     };
 
+    enum class Unit
+    {
+        minutes,
+        seconds,
+        milliseconds
+    };
+
     TriggerObject(Type type) :
         QObject(nullptr), m_type(type) {}
 
@@ -48,10 +58,11 @@ public:
 
     Q_ENUM(Type)
     Q_ENUM(Statement)
+    Q_ENUM(Unit)
 
 protected:
 
-    bool match(const QVariant &oldValue, const QVariant &newValue, Statement statement, QVariant value, bool force);
+    bool match(const QVariant &oldValue, const QVariant &newValue, Statement statement, const StatementValue &value, bool force);
 
 private:
 
@@ -76,7 +87,7 @@ class PropertyTrigger : public TriggerObject
 public:
 
     PropertyTrigger(const QString &endpoint, const QString &property, Statement statement, const QVariant &value, bool force) :
-        TriggerObject(Type::property), m_endpoint(endpoint), m_property(property), m_statement(statement), m_value(value), m_force(force) {}
+        TriggerObject(Type::property), m_endpoint(endpoint), m_property(property), m_statement(statement), m_value(value), m_compiled(value), m_force(force) {}
 
     inline QString endpoint(void) { return m_endpoint; }
     inline QString property(void) { return m_property; }
@@ -84,13 +95,14 @@ public:
     inline QVariant value(void) { return m_value; }
     inline bool force(void) { return m_force; }
 
-    inline bool match(const QVariant &oldValue, const QVariant &newValue) {{ return TriggerObject::match(oldValue, newValue, m_statement, m_value, m_force); }}
+    inline bool match(const QVariant &oldValue, const QVariant &newValue) {{ return TriggerObject::match(oldValue, newValue, m_statement, m_compiled, m_force); }}
 
 private:
 
     QString m_endpoint, m_property;
     Statement m_statement;
     QVariant m_value;
+    StatementValue m_compiled;
     bool m_force;
 
 };
@@ -101,7 +113,7 @@ class MqttTrigger : public TriggerObject
 public:
 
     MqttTrigger(const QString &topic, const QString &property, Statement statement, const QVariant &value, bool force) :
-        TriggerObject(Type::mqtt), m_topic(topic), m_property(property), m_statement(statement), m_value(value), m_force(force) {}
+        TriggerObject(Type::mqtt), m_topic(topic), m_property(property), m_statement(statement), m_value(value), m_compiled(value), m_force(force) {}
 
     inline QString topic(void) { return m_topic; }
     inline QString property(void) { return m_property; }
@@ -109,17 +121,16 @@ public:
     inline QVariant value(void) { return m_value; }
     inline bool force(void) { return m_force; }
 
-    inline bool match(const QByteArray &oldMessage, const QByteArray &newMessage) {{ return TriggerObject::match(parse(oldMessage), parse(newMessage), m_statement, m_value, m_force); }}
+    inline bool match(const QVariant &oldValue, const QVariant &newValue) {{ return TriggerObject::match(oldValue, newValue, m_statement, m_compiled, m_force); }}
 
 private:
 
     QString m_topic, m_property;
     Statement m_statement;
     QVariant m_value;
+    StatementValue m_compiled;
     bool m_force;
 
-    inline QVariant parse(const QByteArray &message) { return m_property.isEmpty() ? message : Parser::jsonValue(message, m_property); }
-
 };
 
 class TelegramTrigger : public TriggerObject
@@ -153,7 +164,8 @@ public:
         TriggerObject(Type::time), m_time(time) {}
 
     inline QVariant value(void) { return m_time; }
-    inline bool match(const QTime &value, Sun *sun) { return value == sun->fromString(m_time.toString()); }
+
+    QTime time(Sun *sun);
 
 private:
 
@@ -166,16 +178,19 @@ class IntervalTrigger : public TriggerObject
 
 public:
 
-    IntervalTrigger(int interval, int offset) :
-        TriggerObject(Type::interval), m_interval(interval), m_offset(offset) {}
+    IntervalTrigger(int interval, int offset, Unit unit) :
+        TriggerObject(Type::interval), m_interval(interval), m_offset(offset), m_unit(unit) {}
 
     inline int interval(void) { return m_interval; }
     inline int offset(void) { return m_offset; }
-    inline bool match(int value) { return !m_interval || value - m_offset < 0 || (value - m_offset) % m_interval ? false : true; }
+    inline Unit unit(void) { return m_unit; }
+
+    qint64 next(qint64 value);
 
 private:
 
     int m_interval, m_offset;
+    Unit m_unit;
 
 };
 
@@ -0,0 +1,103 @@
+#include "runner.h"
+#include "wheel.h"
+
+TimerWheel::TimerWheel(QObject *parent) : QObject(parent), m_timer(new QTimer(this)), m_tick(0), m_index(0), m_active(false)
+{
+    connect(m_timer, &QTimer::timeout, this, &TimerWheel::timeout);
+    m_clock.start();
+}
+
+quint64 TimerWheel::schedule(Runner *runner, qint64 interval)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 deadline = (m_clock.elapsed() + interval + WHEEL_TICK - 1) / WHEEL_TICK;
+    quint64 id = ++m_index;
+
+    if (!m_active)
+    {
+        m_tick = m_clock.elapsed() / WHEEL_TICK;
+        m_active = true;
+        QMetaObject::invokeMethod(this, &TimerWheel::activate, Qt::QueuedConnection);
+    }
+
+    m_entries.insert(id, {deadline, runner});
+    insert(id, deadline);
+    return id;
+}
+
+void TimerWheel::cancel(quint64 id)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.remove(id);
+}
+
+void TimerWheel::insert(quint64 id, qint64 deadline)
+{
+    qint64 delta = qMax(deadline - m_tick, static_cast <qint64> (1)), limit = static_cast <qint64> (1) << (WHEEL_BITS * WHEEL_LEVELS);
+    int level = 0;
+
+    while (level < WHEEL_LEVELS - 1 && delta >= static_cast <qint64> (1) << (WHEEL_BITS * (level + 1)))
+        level++;
+
+    deadline = m_tick + qMin(delta, limit - 1);
+    m_slots[level][(deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)].append(id);
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    QList <quint64> list = m_slots[level][slot];
+
+    m_slots[level][slot].clear();
+
+    for (int i = 0; i < list.count(); i++)
+    {
+        auto it = m_entries.find(list.at(i));
+
+        if (it == m_entries.end())
+            continue;
+
+        if (it.value().first <= m_tick)
+        {
+            it.value().second->expire();
+            m_entries.erase(it);
+            continue;
+        }
+
+        insert(it.key(), it.value().first);
+    }
+}
+
+void TimerWheel::activate(void)
+{
+    if (m_timer->isActive())
+        return;
+
+    m_timer->start(WHEEL_TICK);
+}
+
+void TimerWheel::timeout(void)
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 tick = m_clock.elapsed() / WHEEL_TICK;
+
+    while (m_tick < tick && !m_entries.isEmpty())
+    {
+        m_tick++;
+
+        for (int level = WHEEL_LEVELS - 1; level > 0; level--)
+            if (!(m_tick & ((static_cast <qint64> (1) << (WHEEL_BITS * level)) - 1)))
+                cascade(level, (m_tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+
+        cascade(0, m_tick & (WHEEL_SLOTS - 1));
+    }
+
+    if (!m_entries.isEmpty())
+        return;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++)
+            m_slots[level][slot].clear();
+
+    m_timer->stop();
+    m_active = false;
+}
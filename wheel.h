@@ -0,0 +1,50 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#define WHEEL_TICK      100
+#define WHEEL_BITS      6
+#define WHEEL_SLOTS     (1 << WHEEL_BITS)
+#define WHEEL_LEVELS    4
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QTimer>
+
+class Runner;
+
+class TimerWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    TimerWheel(QObject *parent);
+
+    quint64 schedule(Runner *runner, qint64 interval);
+    void cancel(quint64 id);
+
+private:
+
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    QMutex m_mutex;
+
+    QHash <quint64, QPair <qint64, Runner*>> m_entries;
+    QList <quint64> m_slots[WHEEL_LEVELS][WHEEL_SLOTS];
+
+    qint64 m_tick;
+    quint64 m_index;
+    bool m_active;
+
+    void insert(quint64 id, qint64 deadline);
+    void cascade(int level, int slot);
+
+private slots:
+
+    void activate(void);
+    void timeout(void);
+
+};
+
+#endif